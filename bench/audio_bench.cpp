@@ -0,0 +1,144 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "livekit/audio_convert.h"
+#include "livekit/audio_resampler.h"
+
+namespace livekit
+{
+namespace bench
+{
+
+namespace
+{
+
+// All the benchmarks work on 10ms frames, the size the SDK exchanges
+constexpr int kFrameMs = 10;
+
+std::vector<int16_t> Tone(size_t frames, size_t channels) {
+    std::vector<int16_t> samples(frames * channels);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        samples[i] = static_cast<int16_t>(12000 * std::sin(0.05 * static_cast<double>(i / channels)));
+    }
+    return samples;
+}
+
+// 10ms of 48kHz stereo
+void BM_S16ToFloat(benchmark::State& state) {
+    std::vector<int16_t> src = Tone(480, 2);
+    std::vector<float> dst(src.size());
+    for (auto _ : state) {
+        S16ToFloat(src.data(), dst.data(), src.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(src.size()));
+}
+BENCHMARK(BM_S16ToFloat);
+
+// The kernel picked for this CPU must agree with the scalar one on the
+// edge cases, wherever they fall in the SIMD blocks
+bool FloatToS16EdgeCasesAgree() {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    const std::pair<float, int16_t> cases[] = {
+        {nan, -32768}, {inf, 32767}, {-inf, -32768}, {2.0f, 32767}, {-2.0f, -32768}, {0.5f, 16384},
+    };
+    for (const auto& [value, expected] : cases) {
+        for (size_t position = 0; position < 32; ++position) {
+            std::vector<float> src(32, 0.0f);
+            std::vector<int16_t> dst(src.size());
+            src[position] = value;
+            FloatToS16(src.data(), dst.data(), src.size());
+            if (dst[position] != expected) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void BM_FloatToS16(benchmark::State& state) {
+    if (!FloatToS16EdgeCasesAgree()) {
+        state.SkipWithError("FloatToS16 disagrees with the scalar kernel on NaN or out of range samples");
+        return;
+    }
+    std::vector<int16_t> samples = Tone(480, 2);
+    std::vector<float> src(samples.size());
+    S16ToFloat(samples.data(), src.data(), samples.size());
+    for (auto _ : state) {
+        FloatToS16(src.data(), samples.data(), src.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(src.size()));
+}
+BENCHMARK(BM_FloatToS16);
+
+void BM_RemixStereoToMono(benchmark::State& state) {
+    std::vector<int16_t> src = Tone(480, 2);
+    std::vector<int16_t> dst(480);
+    for (auto _ : state) {
+        RemixS16(src.data(), 2, dst.data(), 1, 480);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * 480);
+}
+BENCHMARK(BM_RemixStereoToMono);
+
+// Mixdown of `range(0)` 48kHz mono participants
+void BM_MixS16(benchmark::State& state) {
+    std::vector<std::vector<int16_t>> tracks(state.range(0), Tone(480, 1));
+    std::vector<const int16_t *> sources;
+    for (const std::vector<int16_t>& track : tracks) {
+        sources.push_back(track.data());
+    }
+    std::vector<int16_t> dst(480);
+    for (auto _ : state) {
+        MixS16(sources.data(), sources.size(), dst.data(), dst.size());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * 480 * state.range(0));
+}
+BENCHMARK(BM_MixS16)->RangeMultiplier(2)->Range(2, 32);
+
+// range(0) -> range(1) Hz with range(2) channels
+void BM_Resample(benchmark::State& state) {
+    uint32_t inputRate = static_cast<uint32_t>(state.range(0));
+    uint32_t outputRate = static_cast<uint32_t>(state.range(1));
+    uint32_t channels = static_cast<uint32_t>(state.range(2));
+    size_t frames = inputRate * kFrameMs / 1000;
+
+    AudioResampler resampler(inputRate, outputRate, channels);
+    std::vector<int16_t> src = Tone(frames, channels);
+    std::vector<int16_t> dst(resampler.MaxOutputFrames(frames) * channels);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(resampler.Process(src.data(), frames, dst.data()));
+    }
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(frames));
+}
+BENCHMARK(BM_Resample)->Args({48000, 16000, 1})->Args({16000, 48000, 1})->Args({44100, 48000, 2});
+
+}
+
+}
+}
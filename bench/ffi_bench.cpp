@@ -0,0 +1,184 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "ffi.pb.h"
+#include "ffi_stub.h"
+#include "livekit/ffi_client.h"
+
+namespace livekit
+{
+namespace bench
+{
+
+namespace
+{
+
+// Serialize, cross into the stub (which decodes the request and encodes a
+// response like the Rust side), parse the response and drop its handle
+void BM_SendRequest(benchmark::State& state) {
+    FfiClient& client = FfiClient::getInstance();
+
+    FFIRequest request;
+    ConnectRequest *connect = request.mutable_connect();
+    connect->set_url("wss://bench.livekit.cloud");
+    connect->set_token(std::string(state.range(0), 't'));
+
+    FFIResponse response;
+    for (auto _ : state) {
+        client.SendRequest(request, response);
+        benchmark::DoNotOptimize(response);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(request.ByteSizeLong()));
+}
+BENCHMARK(BM_SendRequest)->RangeMultiplier(8)->Range(64, 256 << 10);
+
+FFIEvent MakeRoomEvent(const std::string& roomSid) {
+    FFIEvent event;
+    RoomEvent *roomEvent = event.mutable_room_event();
+    roomEvent->set_room_sid(roomSid);
+    roomEvent->mutable_track_muted()->set_participant_sid("PA_bench");
+    roomEvent->mutable_track_muted()->set_track_sid("TR_bench");
+    return event;
+}
+
+// LivekitFfiCallback with `range(0)` listeners, on the emitting thread.
+// Broadcast listeners all see the event, room listeners are spread over as
+// many rooms and only one of them matches.
+void DispatchRoomEvent(benchmark::State& state, bool scoped) {
+    FfiClient& client = FfiClient::getInstance();
+
+    int64_t calls = 0;
+    std::vector<FfiClient::ListenerId> listeners;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        std::string roomSid = "RM_" + std::to_string(i);
+        EventSubscription subscription = scoped ? EventSubscription::ForRoom(roomSid) : EventSubscription::All();
+        listeners.push_back(client.AddListener(subscription, [&calls](const FFIEvent&) { calls++; }));
+    }
+
+    std::string bytes = MakeRoomEvent("RM_0").SerializeAsString();
+    for (auto _ : state) {
+        EmitEvent(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+    }
+
+    for (FfiClient::ListenerId id : listeners) {
+        client.RemoveListener(id);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["listener_calls"] = benchmark::Counter(static_cast<double>(calls), benchmark::Counter::kAvgIterations);
+}
+
+void BM_DispatchBroadcast(benchmark::State& state) {
+    DispatchRoomEvent(state, false);
+}
+BENCHMARK(BM_DispatchBroadcast)->RangeMultiplier(4)->Range(1, 1024);
+
+void BM_DispatchRoomScoped(benchmark::State& state) {
+    DispatchRoomEvent(state, true);
+}
+BENCHMARK(BM_DispatchRoomScoped)->RangeMultiplier(4)->Range(1, 1024);
+
+// `range(0)` listeners spread over the event types, of which only those of
+// RoomEvent run: typed ones, or full listeners switching on the case
+void DispatchTyped(benchmark::State& state, bool typed) {
+    FfiClient& client = FfiClient::getInstance();
+    const FFIEvent::MessageCase types[] = {FFIEvent::kRoomEvent, FFIEvent::kVideoStreamEvent,
+                                           FFIEvent::kAudioStreamEvent, FFIEvent::kConnect};
+
+    int64_t calls = 0;
+    std::vector<FfiClient::ListenerId> listeners;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        FFIEvent::MessageCase type = types[i % 4];
+        if (typed && type == FFIEvent::kRoomEvent) {
+            listeners.push_back(client.Subscribe<RoomEvent>([&calls](const RoomEvent&) { calls++; }));
+        } else if (typed) {
+            listeners.push_back(client.AddListener(EventSubscription::ForType(type), [](const FFIEvent&) {}));
+        } else {
+            listeners.push_back(client.AddListener([&calls, type](const FFIEvent& event) {
+                if (event.message_case() == type) {
+                    calls++;
+                }
+            }));
+        }
+    }
+
+    std::string bytes = MakeRoomEvent("RM_0").SerializeAsString();
+    for (auto _ : state) {
+        EmitEvent(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+    }
+
+    for (FfiClient::ListenerId id : listeners) {
+        client.RemoveListener(id);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["listener_calls"] = benchmark::Counter(static_cast<double>(calls), benchmark::Counter::kAvgIterations);
+}
+
+void BM_DispatchSwitch(benchmark::State& state) {
+    DispatchTyped(state, false);
+}
+BENCHMARK(BM_DispatchSwitch)->RangeMultiplier(4)->Range(4, 256);
+
+void BM_DispatchTyped(benchmark::State& state) {
+    DispatchTyped(state, true);
+}
+BENCHMARK(BM_DispatchTyped)->RangeMultiplier(4)->Range(4, 256);
+
+// Cost of the most frequent event, a received video frame: decoded for a
+// listener of its stream, or only its header when nobody listens to it.
+// With and without the metrics recording it.
+void BM_DispatchFrameEvent(benchmark::State& state) {
+    FfiClient& client = FfiClient::getInstance();
+    client.EnableMetrics(state.range(0) != 0);
+
+    FfiClient::ListenerId listener = 0;
+    if (state.range(1) != 0) {
+        listener = client.AddListener(EventSubscription::ForHandle(42), [](const FFIEvent& event) {
+            benchmark::DoNotOptimize(&event);
+        });
+    }
+
+    FFIEvent event;
+    VideoStreamEvent *streamEvent = event.mutable_video_stream_event();
+    streamEvent->mutable_handle()->set_id(42);
+    FrameReceived *frame = streamEvent->mutable_frame_received();
+    frame->mutable_frame()->set_timestamp_us(1234567);
+    VideoFrameBufferInfo *buffer = frame->mutable_buffer();
+    buffer->mutable_handle()->set_id(43);
+    buffer->set_buffer_type(VideoFrameBufferType::I420);
+    buffer->set_width(1280);
+    buffer->set_height(720);
+
+    std::string bytes = event.SerializeAsString();
+    for (auto _ : state) {
+        EmitEvent(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+    }
+    if (listener != 0) {
+        client.RemoveListener(listener);
+    }
+    client.EnableMetrics(false);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DispatchFrameEvent)->ArgNames({"metrics", "listened"})->Args({0, 0})->Args({0, 1})->Args({1, 1});
+
+}
+
+}
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// In-process stand-in for livekit_ffi. Requests are decoded and answered with
+// an encoded FFIResponse owned by a handle, like the Rust side does, but
+// nothing leaves the process: async operations get an FFIAsyncId and never
+// complete, buffers are plain heap allocations.
+
+#include "ffi_stub.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "ffi.pb.h"
+#include "livekit_ffi.h"
+
+namespace livekit
+{
+namespace bench
+{
+
+namespace
+{
+
+using EventCallback = void (*)(const uint8_t *data, size_t len);
+
+std::atomic<EventCallback> eventCallback{nullptr};
+std::atomic<uint64_t> nextId{1};
+
+// What the handles own: response bytes or a buffer allocation
+std::mutex lock;
+std::unordered_map<FfiHandleId, std::string> owned;
+
+FfiHandleId Own(std::string bytes) {
+    FfiHandleId handle = nextId.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(lock);
+    owned.emplace(handle, std::move(bytes));
+    return handle;
+}
+
+// The map's nodes don't move, the bytes stay put until the handle is dropped
+const char *OwnedData(FfiHandleId handle) {
+    std::lock_guard<std::mutex> guard(lock);
+    return owned.at(handle).data();
+}
+
+void Answer(const FFIRequest& request, FFIResponse& response) {
+    switch (request.message_case()) {
+        case FFIRequest::kInitialize:
+            eventCallback.store(reinterpret_cast<EventCallback>(request.initialize().event_callback_ptr()));
+            response.mutable_initialize();
+            break;
+        case FFIRequest::kConnect:
+            response.mutable_connect()->mutable_async_id()->set_id(nextId.fetch_add(1, std::memory_order_relaxed));
+            break;
+        case FFIRequest::kAllocAudioBuffer: {
+            const AllocAudioBufferRequest& alloc = request.alloc_audio_buffer();
+            size_t size = static_cast<size_t>(alloc.num_channels()) * alloc.samples_per_channel() * sizeof(int16_t);
+            FfiHandleId handle = Own(std::string(size, '\0'));
+            AudioFrameBufferInfo *info = response.mutable_alloc_audio_buffer()->mutable_buffer();
+            info->mutable_handle()->set_id(handle);
+            info->set_data_ptr(reinterpret_cast<uint64_t>(OwnedData(handle)));
+            info->set_num_channels(alloc.num_channels());
+            info->set_sample_rate(alloc.sample_rate());
+            info->set_samples_per_channel(alloc.samples_per_channel());
+            break;
+        }
+        case FFIRequest::kNewAudioSource:
+            response.mutable_new_audio_source()->mutable_source()->mutable_handle()->set_id(Own(std::string()));
+            break;
+        case FFIRequest::kCaptureAudioFrame:
+            response.mutable_capture_audio_frame();
+            break;
+        default:
+            break;
+    }
+}
+
+}
+
+void EmitEvent(const uint8_t *data, size_t len) {
+    if (EventCallback callback = eventCallback.load()) {
+        callback(data, len);
+    }
+}
+
+void EmitEvent(const FFIEvent& event) {
+    std::string bytes = event.SerializeAsString();
+    EmitEvent(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+}
+
+}
+}
+
+using namespace livekit;
+
+extern "C" FfiHandleId livekit_ffi_request(const uint8_t *data, size_t len, const uint8_t **res_ptr, size_t *res_len) {
+    FFIRequest request;
+    if (!request.ParseFromArray(data, static_cast<int>(len))) {
+        return INVALID_HANDLE;
+    }
+
+    FFIResponse response;
+    bench::Answer(request, response);
+
+    std::string bytes = response.SerializeAsString();
+    size_t size = bytes.size();
+    FfiHandleId handle = bench::Own(std::move(bytes));
+    *res_ptr = reinterpret_cast<const uint8_t *>(bench::OwnedData(handle));
+    *res_len = size;
+    return handle;
+}
+
+extern "C" bool livekit_ffi_drop_handle(FfiHandleId handle) {
+    std::lock_guard<std::mutex> guard(bench::lock);
+    return bench::owned.erase(handle) == 1;
+}
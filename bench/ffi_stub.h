@@ -0,0 +1,36 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_BENCH_FFI_STUB_H
+#define LIVEKIT_BENCH_FFI_STUB_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace livekit
+{
+    class FFIEvent;
+
+    namespace bench
+    {
+        // Calls the event callback registered by the FfiClient the way the
+        // Rust side does: synchronously, on the calling thread
+        void EmitEvent(const uint8_t *data, size_t len);
+        void EmitEvent(const FFIEvent& event);
+    }
+}
+
+#endif /* LIVEKIT_BENCH_FFI_STUB_H */
@@ -0,0 +1,57 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "event_queue.h"
+
+namespace livekit
+{
+namespace bench
+{
+
+namespace
+{
+
+// Threads share one queue, even ones push and odd ones pop (a single thread
+// does both). Only successful operations count as items.
+void BM_EventQueueContention(benchmark::State& state) {
+    static EventQueue queue(4096);
+
+    std::vector<uint8_t> event(state.range(0), 0x2a);
+    std::vector<uint8_t> buf;
+    bool push = state.threads() == 1 || state.thread_index() % 2 == 0;
+    bool pop = state.threads() == 1 || state.thread_index() % 2 == 1;
+
+    int64_t items = 0;
+    for (auto _ : state) {
+        if (push) {
+            items += queue.TryPush(event.data(), event.size());
+        }
+        if (pop) {
+            items += queue.TryPop(buf);
+        }
+    }
+    state.SetItemsProcessed(items);
+}
+BENCHMARK(BM_EventQueueContention)->Arg(64)->Arg(1024)->ThreadRange(1, 16)->UseRealTime();
+
+}
+
+}
+}
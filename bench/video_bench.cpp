@@ -0,0 +1,100 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "livekit/video_convert.h"
+
+namespace livekit
+{
+namespace bench
+{
+
+namespace
+{
+
+// Working buffers of a `width` x `height` frame, in every layout the kernels use
+struct Frame {
+    int width;
+    int height;
+    std::vector<uint8_t> y, u, v, uv, rgba;
+
+    Frame(int w, int h) : width(w), height(h), y(w * h, 0x80), u((w / 2) * (h / 2), 0x40), v((w / 2) * (h / 2), 0xc0),
+                          uv(w * (h / 2), 0x60), rgba(w * h * 4, 0x90) {}
+};
+
+void SetPixels(benchmark::State& state, const Frame& frame) {
+    state.SetItemsProcessed(state.iterations() * frame.width * frame.height);
+}
+
+void BM_I420ToRGBA(benchmark::State& state) {
+    Frame frame(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    int w = frame.width;
+    for (auto _ : state) {
+        I420ToRGBA(frame.y.data(), w, frame.u.data(), w / 2, frame.v.data(), w / 2,
+                   frame.rgba.data(), w * 4, w, frame.height);
+        benchmark::ClobberMemory();
+    }
+    SetPixels(state, frame);
+}
+BENCHMARK(BM_I420ToRGBA)->Args({640, 360})->Args({1280, 720})->Args({1920, 1080});
+
+void BM_NV12ToI420(benchmark::State& state) {
+    Frame frame(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    int w = frame.width;
+    std::vector<uint8_t> y(frame.y.size());
+    for (auto _ : state) {
+        NV12ToI420(frame.y.data(), w, frame.uv.data(), w, y.data(), w, frame.u.data(), w / 2,
+                   frame.v.data(), w / 2, w, frame.height);
+        benchmark::ClobberMemory();
+    }
+    SetPixels(state, frame);
+}
+BENCHMARK(BM_NV12ToI420)->Args({640, 360})->Args({1280, 720})->Args({1920, 1080});
+
+void BM_ARGBToI420(benchmark::State& state) {
+    Frame frame(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+    int w = frame.width;
+    for (auto _ : state) {
+        ARGBToI420(frame.rgba.data(), w * 4, frame.y.data(), w, frame.u.data(), w / 2,
+                   frame.v.data(), w / 2, w, frame.height);
+        benchmark::ClobberMemory();
+    }
+    SetPixels(state, frame);
+}
+BENCHMARK(BM_ARGBToI420)->Args({640, 360})->Args({1280, 720})->Args({1920, 1080});
+
+// Luma plane of a 720p frame scaled to `range(0)` x `range(1)`
+void BM_ScalePlane(benchmark::State& state) {
+    Frame frame(1280, 720);
+    int dstWidth = static_cast<int>(state.range(0));
+    int dstHeight = static_cast<int>(state.range(1));
+    std::vector<uint8_t> dst(static_cast<size_t>(dstWidth) * dstHeight);
+    for (auto _ : state) {
+        ScalePlane(frame.y.data(), frame.width, frame.width, frame.height, dst.data(), dstWidth, dstWidth, dstHeight);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * dstWidth * dstHeight);
+}
+BENCHMARK(BM_ScalePlane)->Args({320, 180})->Args({640, 360})->Args({1920, 1080});
+
+}
+
+}
+}
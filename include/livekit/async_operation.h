@@ -0,0 +1,77 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_ASYNC_OPERATION_H
+#define LIVEKIT_ASYNC_OPERATION_H
+
+#include <functional>
+#include <memory>
+#include <utility>
+
+#include "livekit/executor.h"
+
+namespace livekit
+{
+    // Operation started lazily when awaited with C++20 `co_await`.
+    // The coroutine is suspended until the FFI callback of the operation
+    // arrives, and then resumed on `executor`, or directly on the thread that
+    // delivered the callback if none was given. No thread or condition
+    // variable is involved while the operation is pending.
+    //
+    // This header doesn't depend on <coroutine>, so the SDK itself can be
+    // built as C++17 while applications await on its operations.
+    template<typename Result>
+    class AsyncOperation
+    {
+    public:
+        using Complete = std::function<void(const Result&)>;
+        using Start = std::function<void(Complete)>;
+
+        explicit AsyncOperation(Start start, Executor executor = nullptr)
+            : start_(std::move(start)), executor_(std::move(executor)), state_(std::make_shared<State>()) {}
+
+        bool await_ready() const noexcept { return false; }
+
+        template<typename CoroutineHandle>
+        void await_suspend(CoroutineHandle handle) {
+            // The operation may complete (and destroy this awaitable along with
+            // the coroutine frame) before start returns, don't touch members
+            // once it has been called
+            Start start = std::move(start_);
+            start([state = state_, executor = executor_, handle](const Result& result) mutable {
+                state->result = result;
+                if (executor) {
+                    executor([handle]() mutable { handle.resume(); });
+                } else {
+                    handle.resume();
+                }
+            });
+        }
+
+        Result await_resume() { return std::move(state_->result); }
+
+    private:
+        struct State {
+            Result result;
+        };
+
+        Start start_;
+        Executor executor_;
+        std::shared_ptr<State> state_;
+    };
+}
+
+#endif /* LIVEKIT_ASYNC_OPERATION_H */
@@ -0,0 +1,52 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_AUDIO_CONVERT_H
+#define LIVEKIT_AUDIO_CONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "livekit/audio_frame.h"
+
+namespace livekit
+{
+    // PCM sample kernels (SSE2/AVX2/NEON, picked at runtime). They work in
+    // place on interleaved samples, e.g. the data of an AudioFrameBuffer, and
+    // write into caller-provided buffers. Whole array sizes are in samples,
+    // `frames` counts are in samples per channel.
+
+    // Full scale is [-1, 1), FloatToS16 rounds to nearest and saturates,
+    // NaN gives -32768 on every architecture
+    void S16ToFloat(const int16_t *src, float *dst, size_t count);
+    void FloatToS16(const float *src, int16_t *dst, size_t count);
+
+    // Changes the channel count of interleaved audio. Mono is duplicated to
+    // every channel, downmixing to mono averages the channels, otherwise
+    // channels are kept by index and missing ones are silent.
+    void RemixS16(const int16_t *src, size_t srcChannels, int16_t *dst, size_t dstChannels, size_t frames);
+
+    // dst = sum of the sources, saturated once at the end (so intermediate
+    // overflows between sources don't clip). `dst` may alias a source.
+    void MixS16(const int16_t *const *sources, size_t numSources, int16_t *dst, size_t count);
+
+    // Mixes same-format remote buffers into `dst` (at least as many samples
+    // as the buffers). Throws std::invalid_argument on a format mismatch.
+    void MixS16(const std::vector<const AudioFrameBuffer *>& sources, int16_t *dst);
+}
+
+#endif /* LIVEKIT_AUDIO_CONVERT_H */
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_AUDIO_FRAME_H
+#define LIVEKIT_AUDIO_FRAME_H
+
+#include <cstdint>
+#include <memory>
+
+#include "audio_frame.pb.h"
+#include "livekit/ffi_client.h"
+
+namespace livekit
+{
+    // Interleaved int16 PCM owned by the FFI. Like VideoFrameBuffer, the
+    // samples are accessed in place and released with the buffer handle.
+    class AudioFrameBuffer
+    {
+    public:
+        // Takes ownership of the buffer handle of `info`
+        explicit AudioFrameBuffer(const AudioFrameBufferInfo& info);
+
+        AudioFrameBuffer(const AudioFrameBuffer&) = delete;
+        AudioFrameBuffer& operator=(const AudioFrameBuffer&) = delete;
+
+        static std::unique_ptr<AudioFrameBuffer> Allocate(uint32_t sampleRate, uint32_t numChannels,
+                                                          uint32_t samplesPerChannel);
+
+        int16_t *GetData() { return data_; }
+        const int16_t *GetData() const { return data_; }
+        uint32_t GetNumChannels() const { return numChannels_; }
+        uint32_t GetSampleRate() const { return sampleRate_; }
+        uint32_t GetSamplesPerChannel() const { return samplesPerChannel_; }
+        size_t GetNumSamples() const { return static_cast<size_t>(numChannels_) * samplesPerChannel_; }
+        uintptr_t GetHandle() const { return handle_.handle; }
+
+    private:
+        FfiHandle handle_;
+        int16_t *data_;
+        uint32_t numChannels_;
+        uint32_t sampleRate_;
+        uint32_t samplesPerChannel_;
+    };
+}
+
+#endif /* LIVEKIT_AUDIO_FRAME_H */
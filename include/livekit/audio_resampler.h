@@ -0,0 +1,73 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_AUDIO_RESAMPLER_H
+#define LIVEKIT_AUDIO_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "livekit/audio_frame.h"
+
+namespace livekit
+{
+    // Streaming polyphase resampler for interleaved int16 audio, e.g. 48kHz
+    // to 16kHz for speech recognition. It runs in-process (the filter dot
+    // products use SIMD), keeps its state between calls, and only allocates
+    // when a call gets more input than any previous one.
+    class AudioResampler
+    {
+    public:
+        // `tapsPerPhase` trades quality for CPU (and latency, half of it in
+        // input samples). Throws std::invalid_argument for rates whose
+        // ratio needs more than 1024 filter phases.
+        AudioResampler(uint32_t inputRate, uint32_t outputRate, uint32_t numChannels, uint32_t tapsPerPhase = 32);
+
+        // Upper bound of the frames Process produces for `inputFrames`
+        size_t MaxOutputFrames(size_t inputFrames) const;
+
+        // Returns the number of frames written to `output`, which must hold
+        // MaxOutputFrames(inputFrames) frames
+        size_t Process(const int16_t *input, size_t inputFrames, int16_t *output);
+        size_t Process(const AudioFrameBuffer& input, int16_t *output);
+
+        uint32_t GetInputRate() const { return inputRate_; }
+        uint32_t GetOutputRate() const { return outputRate_; }
+        uint32_t GetNumChannels() const { return numChannels_; }
+
+    private:
+        uint32_t inputRate_;
+        uint32_t outputRate_;
+        uint32_t numChannels_;
+        uint32_t up_;
+        uint32_t down_;
+        uint32_t taps_;
+
+        // taps_ coefficients per phase, reversed to run forward on the input
+        std::vector<float> filter_;
+
+        // Per channel: taps_ - 1 frames of history, then the current input
+        std::vector<float> buffer_;
+        size_t bufferFrames_{0};
+
+        // Position of the next output, in input frames and phase
+        size_t position_{0};
+        uint32_t phase_{0};
+    };
+}
+
+#endif /* LIVEKIT_AUDIO_RESAMPLER_H */
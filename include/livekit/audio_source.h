@@ -0,0 +1,71 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_AUDIO_SOURCE_H
+#define LIVEKIT_AUDIO_SOURCE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+#include "livekit/ffi_client.h"
+
+namespace livekit
+{
+    template<typename T>
+    class SpscRing;
+
+    // Native audio source fed from a capture callback (CoreAudio, ALSA...).
+    // CaptureFrame only copies the samples into a wait-free ring: it never
+    // locks, allocates or calls into the FFI, so it is safe on real-time
+    // threads. A thread owned by the source drains the ring and sends the
+    // samples to the FFI in 10ms frames, through a single reused buffer.
+    class AudioSource
+    {
+    public:
+        // Up to `queueMs` of audio is buffered between the two threads
+        AudioSource(uint32_t sampleRate, uint32_t numChannels, uint32_t queueMs = 200);
+        ~AudioSource();
+
+        AudioSource(const AudioSource&) = delete;
+        AudioSource& operator=(const AudioSource&) = delete;
+
+        // `data` holds `samplesPerChannel` interleaved frames. Returns how many
+        // were queued, what doesn't fit is dropped.
+        size_t CaptureFrame(const int16_t *data, size_t samplesPerChannel);
+
+        // To create the audio track
+        uintptr_t GetHandle() const { return handle_.handle; }
+
+        uint32_t GetSampleRate() const { return sampleRate_; }
+        uint32_t GetNumChannels() const { return numChannels_; }
+        uint64_t GetDroppedSamples() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        FfiHandle handle_;
+        uint32_t sampleRate_;
+        uint32_t numChannels_;
+        std::unique_ptr<SpscRing<int16_t>> ring_;
+        std::atomic<uint64_t> dropped_{0};
+        std::atomic<bool> running_{true};
+        std::thread thread_;
+
+        void Run();
+    };
+}
+
+#endif /* LIVEKIT_AUDIO_SOURCE_H */
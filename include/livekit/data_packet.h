@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_DATA_PACKET_H
+#define LIVEKIT_DATA_PACKET_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "livekit/ffi_client.h"
+#include "room.pb.h"
+
+namespace livekit
+{
+    // Non-owning view of bytes, std::span<const uint8_t> before C++20
+    struct ByteSpan {
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+
+        ByteSpan() = default;
+        ByteSpan(const uint8_t *data, size_t size) : data(data), size(size) {}
+        ByteSpan(const std::vector<uint8_t>& bytes) : data(bytes.data()), size(bytes.size()) {}
+        ByteSpan(const std::string& bytes) : ByteSpan(std::string_view(bytes)) {}
+        ByteSpan(std::string_view bytes)
+            : data(reinterpret_cast<const uint8_t *>(bytes.data())), size(bytes.size()) {}
+
+        const uint8_t *begin() const { return data; }
+        const uint8_t *end() const { return data + size; }
+        bool empty() const { return size == 0; }
+    };
+
+    // A received data packet. Its bytes are read in place from the buffer
+    // the FFI received them in, which is released with the last copy of the
+    // packet (packets coalesced by the sender share it).
+    class DataPacket
+    {
+    public:
+        DataPacket(std::shared_ptr<const FfiHandle> buffer, ByteSpan data, std::string participantSid,
+                   DataPacketKind kind)
+            : buffer_(std::move(buffer)), data_(data), participantSid_(std::move(participantSid)), kind_(kind) {}
+
+        ByteSpan GetData() const { return data_; }
+        // Empty when sent by the server
+        const std::string& GetParticipantSid() const { return participantSid_; }
+        DataPacketKind GetKind() const { return kind_; }
+
+    private:
+        std::shared_ptr<const FfiHandle> buffer_;
+        ByteSpan data_;
+        std::string participantSid_;
+        DataPacketKind kind_;
+    };
+
+    // Coalescing of small data packets, see Room::EnableDataBatching
+    struct DataBatchOptions {
+        // Longest a packet waits for others to share its FFI call
+        std::chrono::microseconds window{2000};
+        // Size a batch is sent at, within the data channel message limit.
+        // Larger packets are sent on their own.
+        size_t maxBytes = 15000;
+    };
+}
+
+#endif /* LIVEKIT_DATA_PACKET_H */
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_EVENT_LOG_H
+#define LIVEKIT_EVENT_LOG_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "livekit/ffi_client.h"
+
+namespace livekit
+{
+    // An FFIEvent as it was received, see EventLogWriter
+    struct LoggedEvent {
+        // Since the first event of the log
+        std::chrono::microseconds offset{0};
+        // The encoded FFIEvent
+        std::string bytes;
+        // What the data pointer of a DataReceived event pointed to, empty
+        // for other events. Buffer memory (frames and samples) isn't kept.
+        std::string payload;
+    };
+
+    // Records every event the FfiClient receives to `path`, until
+    // destroyed, e.g. to replay a real session against the mocked FFI (see
+    // mock::Replayer). Each record is the offset in microseconds (8 bytes),
+    // then the event and the payload, each prefixed with their size (4
+    // bytes), all little-endian. Throws std::runtime_error if the file
+    // can't be created.
+    class EventLogWriter
+    {
+    public:
+        explicit EventLogWriter(const std::string& path);
+        ~EventLogWriter();
+
+        EventLogWriter(const EventLogWriter&) = delete;
+        EventLogWriter& operator=(const EventLogWriter&) = delete;
+
+        uint64_t GetEventCount() const;
+
+    private:
+        // Shared with the listener, which only holds it weakly: a dispatch
+        // already in flight may still append after the writer is destroyed
+        struct State {
+            std::mutex lock;
+            std::ofstream file;
+            std::chrono::steady_clock::time_point start;
+            bool started{false};
+            bool closed{false};
+            uint64_t count{0};
+
+            void Append(const FFIEvent& event);
+        };
+        std::shared_ptr<State> state_;
+        FfiClient::ListenerId listenerId_;
+    };
+
+    // Throws std::runtime_error if the file can't be read or is truncated
+    std::vector<LoggedEvent> ReadEventLog(const std::string& path);
+}
+
+#endif /* LIVEKIT_EVENT_LOG_H */
@@ -0,0 +1,72 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_EVENT_TRAITS_H
+#define LIVEKIT_EVENT_TRAITS_H
+
+#include <cstddef>
+#include <initializer_list>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+    // Maps each payload of the FFIEvent oneof to its case, see
+    // FfiClient::Subscribe. Left undefined for other types, so subscribing
+    // to one doesn't compile.
+    template<typename T>
+    struct EventTraits;
+
+    // Payload type, accessor and case of each FFIEvent oneof member
+#define LIVEKIT_FOR_EACH_EVENT(X)                                                 \
+    X(RoomEvent, room_event, kRoomEvent)                                          \
+    X(TrackEvent, track_event, kTrackEvent)                                       \
+    X(ParticipantEvent, participant_event, kParticipantEvent)                     \
+    X(VideoStreamEvent, video_stream_event, kVideoStreamEvent)                    \
+    X(AudioStreamEvent, audio_stream_event, kAudioStreamEvent)                    \
+    X(ConnectCallback, connect, kConnect)                                         \
+    X(DisconnectCallback, disconnect, kDisconnect)                                \
+    X(DisposeCallback, dispose, kDispose)                                         \
+    X(PublishTrackCallback, publish_track, kPublishTrack)                         \
+    X(UnpublishTrackCallback, unpublish_track, kUnpublishTrack)                   \
+    X(PublishDataCallback, publish_data, kPublishData)
+
+#define LIVEKIT_EVENT_TRAITS(Type, field, Case)                                   \
+    template<>                                                                    \
+    struct EventTraits<Type> {                                                    \
+        static constexpr FFIEvent::MessageCase kCase = FFIEvent::Case;            \
+        static const Type& Get(const FFIEvent& event) { return event.field(); }   \
+    };
+
+    LIVEKIT_FOR_EACH_EVENT(LIVEKIT_EVENT_TRAITS)
+
+#define LIVEKIT_EVENT_CASE(Type, field, Case) static_cast<size_t>(FFIEvent::Case),
+
+    // One past the largest case above, e.g. to index tables by case
+    constexpr size_t kEventCaseLimit = [] {
+        size_t limit = 0;
+        for (size_t eventCase : {LIVEKIT_FOR_EACH_EVENT(LIVEKIT_EVENT_CASE)}) {
+            limit = eventCase >= limit ? eventCase + 1 : limit;
+        }
+        return limit;
+    }();
+
+#undef LIVEKIT_EVENT_CASE
+#undef LIVEKIT_EVENT_TRAITS
+#undef LIVEKIT_FOR_EACH_EVENT
+}
+
+#endif /* LIVEKIT_EVENT_TRAITS_H */
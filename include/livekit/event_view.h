@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_EVENT_VIEW_H
+#define LIVEKIT_EVENT_VIEW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <google/protobuf/arena.h>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+    // An FFIEvent of which only the oneof case and the fields it is routed
+    // on are decoded up front. The payload is decoded the first time Get()
+    // is called, once for all the listeners of the event; events nobody
+    // reads are never decoded.
+    class EventView
+    {
+    public:
+        // Views the encoded event, decoding its header. The payload is
+        // decoded on `arena` (or the heap without one), the bytes and the
+        // arena must outlive the view.
+        EventView(const uint8_t *data, size_t len, google::protobuf::Arena *arena = nullptr);
+        // Views an event that is already decoded
+        explicit EventView(const FFIEvent& event);
+
+        EventView(const EventView&) = delete;
+        EventView& operator=(const EventView&) = delete;
+
+        // False if the header is malformed, nothing else can be used then
+        bool IsValid() const { return valid_; }
+
+        FFIEvent::MessageCase GetType() const { return type_; }
+        // FFIAsyncId of callbacks, the handle of stream events and the sid of
+        // RoomEvents, or 0 / empty
+        uint64_t GetAsyncId() const { return asyncId_; }
+        uint64_t GetHandleId() const { return handleId_; }
+        const std::string& GetRoomSid() const { return roomSid_; }
+        bool HasRoomSid() const { return type_ == FFIEvent::kRoomEvent; }
+
+        // Decodes the payload on first use. Null if it turns out to be
+        // malformed, the failure is logged once then.
+        const FFIEvent *TryGet() const;
+        // Same, but a malformed payload gives an empty event (MESSAGE_NOT_SET)
+        const FFIEvent& Get() const;
+        bool IsDecoded() const { return event_ != nullptr; }
+
+    private:
+        const uint8_t *data_ = nullptr;
+        size_t len_ = 0;
+        google::protobuf::Arena *arena_ = nullptr;
+
+        bool valid_ = false;
+        FFIEvent::MessageCase type_ = FFIEvent::MESSAGE_NOT_SET;
+        uint64_t asyncId_ = 0;
+        uint64_t handleId_ = 0;
+        std::string roomSid_;
+
+        mutable const FFIEvent *event_ = nullptr;
+        mutable bool malformed_ = false;
+        mutable std::unique_ptr<FFIEvent> owned_;
+    };
+}
+
+#endif /* LIVEKIT_EVENT_VIEW_H */
@@ -0,0 +1,95 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_EXECUTOR_H
+#define LIVEKIT_EXECUTOR_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace livekit
+{
+    // Runs the given task, e.g. by posting it to an event loop or thread pool
+    using Executor = std::function<void(std::function<void()>)>;
+
+    // Runs the tasks posted to it one at a time and in order, on the threads
+    // of the underlying executor (which may run tasks concurrently). Copies
+    // share the same queue. Tasks already posted still run once every copy
+    // is destroyed.
+    class Strand
+    {
+    public:
+        explicit Strand(Executor executor);
+
+        void Post(std::function<void()> task) const;
+        // Posts to this strand
+        Executor AsExecutor() const;
+
+    private:
+        struct State;
+        std::shared_ptr<State> state_;
+    };
+
+    // Scheduling of a thread, see ApplyThreadAffinity
+    struct ThreadAffinity {
+        // CPUs the thread may run on, any if empty
+        std::vector<int> cpus;
+        // Real-time (SCHED_FIFO) priority, 0 to keep the default policy. Needs
+        // the privilege to raise priorities.
+        int realtimePriority = 0;
+        // Shown by debuggers and profilers, truncated to 15 characters
+        std::string name;
+    };
+
+    // Applies `affinity` to the calling thread. Returns false if any of it
+    // couldn't be applied (or isn't supported on this platform), the rest
+    // still is.
+    bool ApplyThreadAffinity(const ThreadAffinity& affinity);
+
+    // Threads running the tasks posted to them, in order with a single
+    // thread. Must outlive the executors it hands out; the destructor runs
+    // the tasks already posted, then joins the threads.
+    class ThreadPoolExecutor
+    {
+    public:
+        explicit ThreadPoolExecutor(size_t threads = 1, const ThreadAffinity& affinity = {});
+        ~ThreadPoolExecutor();
+
+        ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+        ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+
+        void Post(std::function<void()> task);
+        Executor GetExecutor();
+
+    private:
+        std::mutex lock_;
+        std::condition_variable wakeup_;
+        std::deque<std::function<void()>> tasks_;
+        bool stopped_{false};
+        std::vector<std::thread> threads_;
+
+        void Run(const ThreadAffinity& affinity);
+    };
+}
+
+#endif /* LIVEKIT_EXECUTOR_H */
@@ -17,25 +17,135 @@
 #ifndef LIVEKIT_FFI_CLIENT_H
 #define LIVEKIT_FFI_CLIENT_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 #include <functional>
+#include <future>
 #include <mutex>
+#include <set>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "ffi.pb.h"
+#include "livekit/event_traits.h"
+#include "livekit/event_view.h"
+#include "livekit/executor.h"
+#include "livekit/metrics.h"
+#include "livekit_ffi.h"
 
 namespace livekit
 {
     extern "C" void LivekitFfiCallback(const uint8_t *buf, size_t len);
 
+    class EventQueue;
+    class EventRouter;
+    class HandleReleaser;
+
+    // Selects the events delivered to a listener. Events are indexed by these
+    // keys, so a listener only runs for the events it subscribed to.
+    struct EventSubscription {
+        enum class Kind { All, Type, AsyncId, Handle, Room };
+
+        Kind kind = Kind::All;
+        FFIEvent::MessageCase type = FFIEvent::MESSAGE_NOT_SET;
+        uint64_t id = 0;
+        std::string roomSid;
+
+        static EventSubscription All() { return EventSubscription{}; }
+
+        // Every event of the given FFIEvent oneof case, see also
+        // FfiClient::Subscribe
+        static EventSubscription ForType(FFIEvent::MessageCase type) {
+            EventSubscription subscription;
+            subscription.kind = Kind::Type;
+            subscription.type = type;
+            return subscription;
+        }
+
+        // Callbacks carrying the FFIAsyncId of a request
+        static EventSubscription ForAsyncId(uint64_t asyncId) {
+            EventSubscription subscription;
+            subscription.kind = Kind::AsyncId;
+            subscription.id = asyncId;
+            return subscription;
+        }
+
+        // Stream events of the given audio/video stream handle
+        static EventSubscription ForHandle(uint64_t handleId) {
+            EventSubscription subscription;
+            subscription.kind = Kind::Handle;
+            subscription.id = handleId;
+            return subscription;
+        }
+
+        // RoomEvents of the given room
+        static EventSubscription ForRoom(const std::string& roomSid) {
+            EventSubscription subscription;
+            subscription.kind = Kind::Room;
+            subscription.roomSid = roomSid;
+            return subscription;
+        }
+    };
+
+    // Queued dispatch mode, see FfiClient::EnableEventQueue
+    struct EventQueueOptions {
+        size_t capacity = 4096;
+        // Events are no longer delivered in order with more than one thread,
+        // unless they are pinned. With none, the application drains the queue
+        // itself, see PollEvents.
+        size_t dispatcherThreads = 1;
+        // Gives every dispatcher thread its own queue of `capacity` events
+        // and pins each room (by sid) and each stream (by handle) to one
+        // thread: their events stay in order, while separate rooms are spread
+        // over the threads instead of contending for a single queue. Other
+        // events go to any thread.
+        bool pinned = false;
+        // Runs first on each dispatcher thread, given its index (the one of
+        // GetRoomDispatcher), e.g. to ApplyThreadAffinity
+        std::function<void(size_t index)> onDispatcherStart;
+    };
+
+    // Events are split into audio and video stream events and all the
+    // others, see FfiClient::SetEventExecutor
+    enum class EventClass { Control, Audio, Video };
+
+    struct EventQueueStats {
+        size_t depth;
+        size_t capacity;
+        uint64_t enqueued;
+        uint64_t dropped;
+        // Of the dropped events, those owning handles (frame buffers, data
+        // packets, a connected room...), which were released
+        uint64_t droppedWithHandles;
+    };
+
+    // Deferred release of the handles dropped by FfiHandle, see
+    // FfiClient::EnableDeferredHandleRelease
+    struct HandleReleaseOptions {
+        // Pending handles that wake the release thread up
+        size_t batchSize = 256;
+        // Longest a dropped handle waits to be released
+        std::chrono::milliseconds maxDelay{20};
+    };
+
     // The FfiClient is used to communicate with the FFI interface of the Rust SDK
     // We use the generated protocol messages to facilitate the communication
     class FfiClient
     {
     public:
         using ListenerId = int;
+        // Events are decoded into a recycled arena: the reference passed to a
+        // listener is only valid for the duration of the call. Events whose
+        // payload doesn't decode skip these listeners (and Subscribe's).
         using Listener = std::function<void(const FFIEvent&)>;
+        // Gets the event undecoded, see EventView. Same lifetime as above.
+        using ViewListener = std::function<void(const EventView&)>;
 
         FfiClient(const FfiClient&) = delete;
         FfiClient& operator=(const FfiClient&) = delete;
@@ -45,28 +155,194 @@ namespace livekit
             return instance;
         }
  
+        // Registration never waits for in-flight events, and listeners may
+        // add or remove listeners (including themselves) while being called.
+        // An event already being dispatched may still reach a listener right
+        // after it was removed.
         ListenerId AddListener(const Listener& listener);
+        ListenerId AddListener(const EventSubscription& subscription, const Listener& listener);
+        // Events are decoded for the listeners above, while these only
+        // decode the ones they need: a listener that filters on the type or
+        // routing fields lets every other event through at almost no cost
+        ListenerId AddViewListener(const EventSubscription& subscription, const ViewListener& listener);
         void RemoveListener(ListenerId id);
 
+        // Typed listeners. `T` is one of the FFIEvent oneof payloads (see
+        // EventTraits), e.g. Subscribe<ConnectCallback>, and `handler` gets
+        // it directly: the case is resolved at compile time, the listener
+        // sits in the table slot of that case, and the handler is called
+        // without going through another std::function.
+        template<typename T, typename Handler>
+        ListenerId Subscribe(Handler handler) {
+            return AddViewListener(EventSubscription::ForType(EventTraits<T>::kCase),
+                                   [handler = std::move(handler)](const EventView& event) {
+                                       if (const FFIEvent *decoded = event.TryGet()) {
+                                           handler(EventTraits<T>::Get(*decoded));
+                                       }
+                                   });
+        }
+        // Narrowed to `subscription`, e.g. Subscribe<VideoStreamEvent> of a
+        // stream handle. Events of other types are skipped undecoded.
+        template<typename T, typename Handler>
+        ListenerId Subscribe(const EventSubscription& subscription, Handler handler) {
+            return AddViewListener(subscription, [handler = std::move(handler)](const EventView& event) {
+                if (event.GetType() != EventTraits<T>::kCase) {
+                    return;
+                }
+                if (const FFIEvent *decoded = event.TryGet()) {
+                    handler(EventTraits<T>::Get(*decoded));
+                }
+            });
+        }
+
         FFIResponse SendRequest(const FFIRequest& request)const;
 
+        // Same as above, but the request is serialized into a buffer reused by
+        // the calling thread and the result is parsed into `response`, so
+        // callers issuing many requests can keep a single response around.
+        // Allocate `response` on a google::protobuf::Arena to also keep the
+        // response payload off the heap.
+        void SendRequest(const FFIRequest& request, FFIResponse& response) const;
+
+        // For requests whose response carries an FFIAsyncId (connect,
+        // disconnect, publish...). The matching callback event completes the
+        // operation directly from the event path; it is delivered to the
+        // listeners as usual too. Throws if the response has no FFIAsyncId.
+        using AsyncCallback = std::function<void(const FFIEvent&)>;
+        void SendAsyncRequest(const FFIRequest& request, AsyncCallback callback);
+        std::future<FFIEvent> SendAsyncRequest(const FFIRequest& request);
+
+        // Async requests sent and not completed yet
+        size_t PendingAsyncRequests() const;
+
+        // By default listeners run on the Rust thread that emitted the event.
+        // Once enabled, the callback only copies the event bytes into a bounded
+        // lock-free queue, and dispatcher threads owned by the FfiClient do the
+        // parsing and call the listeners. Events that don't fit in the queue
+        // are dropped, size it accordingly: the handles they own are released
+        // right away, which costs parsing the event on the FFI thread.
+        // Can only be enabled once.
+        void EnableEventQueue(const EventQueueOptions& options = {});
+        // Sums over all the queues when pinned
+        EventQueueStats GetEventQueueStats() const;
+
+        // Index of the dispatcher thread a room is pinned to, e.g. to run the
+        // room's own work next to it. 0 unless the queue is pinned.
+        size_t GetRoomDispatcher(const std::string& roomSid) const;
+
+        // When the event queue is enabled without dispatcher threads, listeners
+        // only run from these calls, on the calling thread, so the app can
+        // drain events once per frame or audio tick without any locking on
+        // its side. Both return the number of events dispatched.
+        // Async requests also complete from here in that mode.
+        size_t PollEvents(size_t maxEvents = SIZE_MAX);
+        // Blocks until at least one event is available, or `timeout` elapsed
+        size_t WaitEvents(std::chrono::milliseconds timeout = std::chrono::milliseconds::max(),
+                          size_t maxEvents = SIZE_MAX);
+
+        // Hands the events of a class over to `executor` (or back to the
+        // thread dispatching them with nullptr), e.g. to keep audio on pinned
+        // cores while control events run elsewhere. The event bytes are
+        // copied for the task, which parses the event and calls the
+        // listeners. Events of the class stay in order if the executor
+        // runs its tasks in order (one thread, or a Strand).
+        void SetEventExecutor(EventClass eventClass, Executor executor);
+
+        // By default FfiHandle releases its handle synchronously, which
+        // costs an FFI call on the dropping thread: tearing down a room drops
+        // every frame and track handle from the event thread. Once enabled,
+        // drops are queued and released in batches by a thread owned by the
+        // FfiClient. Can only be enabled once.
+        void EnableDeferredHandleRelease(const HandleReleaseOptions& options = {});
+        // Releases the deferred handles now, on the calling thread
+        void FlushHandleReleases();
+
+        // Records SendRequest latency per request type, event parse time and
+        // the time spent in listeners, see FfiMetrics. Off by default; when
+        // off, recording costs a relaxed load per request and event.
+        void EnableMetrics(bool enabled = true);
+        // Merged over all the threads, safe to call from any thread
+        FfiMetrics GetMetrics() const;
+
+        // Records trace spans of requests, events and each listener call,
+        // plus async requests from send to callback (tracked by FFIAsyncId),
+        // until StopTracing writes them to `path` as a Chrome trace JSON file
+        // (open it in Perfetto or chrome://tracing). Events past
+        // `maxEventsPerThread` are dropped. Returns false unless the SDK was
+        // built with LIVEKIT_ENABLE_TRACING.
+        bool StartTracing(size_t maxEventsPerThread = 1 << 20);
+        bool StopTracing(const std::string& path);
+
     private:
-        std::unordered_map<ListenerId, Listener> listeners_;
+        // Immutable snapshot, replaced as a whole by writers (under lock_) and
+        // read without any lock by PushEvent
+        std::shared_ptr<const EventRouter> router_;
+        // Where each listener was registered, to remove it. Under lock_.
+        std::unordered_map<ListenerId, EventSubscription> subscriptions_;
         ListenerId nextListenerId = 1;
         mutable std::mutex lock_;
 
+        // Pending async requests by FFIAsyncId. A callback can beat the
+        // response of its own request: the thread dispatching it then waits
+        // for the sends in flight to register their ids, so the callback
+        // still runs ahead of the events behind it. Only a callback emitted
+        // on the sending thread itself is kept in earlyAsync_ for its sender.
+        mutable std::mutex asyncLock_;
+        std::condition_variable asyncRegistered_;
+        std::unordered_map<uint64_t, AsyncCallback> pendingAsync_;
+        std::unordered_map<uint64_t, FFIEvent> earlyAsync_;
+        // Sends in flight, by sequence number
+        std::set<uint64_t> asyncSends_;
+        uint64_t nextAsyncSend_{0};
+        std::atomic<size_t> asyncOutstanding_{0};
+
+        // A single shared queue, or one per dispatcher thread when pinned.
+        // Built before queueCount_ is published and left untouched after.
+        std::vector<std::unique_ptr<EventQueue>> eventQueues_;
+        std::atomic<size_t> queueCount_{0};
+        std::atomic<size_t> nextQueue_{0};
+        std::atomic<uint64_t> droppedWithHandles_{0};
+        std::vector<std::thread> dispatchers_;
+        bool polled_{false};
+
+        std::unique_ptr<HandleReleaser> releaser_;
+
+        // By EventClass, swapped atomically. The flag keeps the executor-less
+        // path to a relaxed load.
+        std::shared_ptr<const Executor> eventExecutors_[3];
+        std::atomic<bool> hasEventExecutors_{false};
+
         FfiClient();
-        ~FfiClient() = default;
+        ~FfiClient();
 
-        void PushEvent(const FFIEvent& event) const;
+        void DispatchEvent(const uint8_t *buf, size_t len);
+        bool SubmitEvent(const uint8_t *buf, size_t len);
+        void DispatchEventNow(const uint8_t *buf, size_t len);
+        EventQueue& GetPolledQueue() const;
+        void QueueEvent(const uint8_t *buf, size_t len, size_t queueCount);
+        void PushEvent(const EventView& event);
+        void CompleteAsync(uint64_t asyncId, const EventView& event);
+        void FinishAsyncSend(uint64_t send);
         friend void LivekitFfiCallback(const uint8_t *buf, size_t len);
     };
 
+    // Owns an FFI handle and drops it when destroyed. Move-only, so a
+    // handle is always dropped exactly once.
     struct FfiHandle {
         uintptr_t handle;
 
-        FfiHandle(uintptr_t handle);
+        explicit FfiHandle(uintptr_t handle);
         ~FfiHandle();
+
+        FfiHandle(const FfiHandle&) = delete;
+        FfiHandle& operator=(const FfiHandle&) = delete;
+        FfiHandle(FfiHandle&& other) noexcept;
+        FfiHandle& operator=(FfiHandle&& other) noexcept;
+
+        // Gives up ownership without dropping the handle
+        uintptr_t Release();
+        // Drops the current handle and takes `handle`
+        void Reset(uintptr_t handle = INVALID_HANDLE);
     };
 }
 
@@ -14,4 +14,22 @@
  * limitations under the License.
  */
 
+#include "audio_convert.h"
+#include "audio_frame.h"
+#include "audio_resampler.h"
+#include "audio_source.h"
+#include "data_packet.h"
+#include "event_log.h"
+#include "event_traits.h"
+#include "event_view.h"
+#include "executor.h"
+#include "metrics.h"
+#include "participant.h"
+#include "prewarm.h"
 #include "room.h"
+#include "video_buffer_allocator.h"
+#include "video_convert.h"
+#include "video_frame.h"
+#include "video_frame_pool.h"
+#include "video_frame_queue.h"
+#include "video_source.h"
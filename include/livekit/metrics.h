@@ -0,0 +1,83 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_METRICS_H
+#define LIVEKIT_METRICS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace livekit
+{
+    // Latency distribution in nanoseconds. Buckets are log-linear like an
+    // HDR histogram: 8 per power of two, so any value is known within 12.5%.
+    struct LatencyHistogram {
+        static constexpr size_t kSubBuckets = 8;
+        static constexpr size_t kBucketCount = 280;     // up to ~68s, larger values land in the last one
+
+        uint64_t count = 0;
+        uint64_t sumNs = 0;
+        uint64_t minNs = 0;
+        uint64_t maxNs = 0;
+        // counts[i] is the number of values in [BucketLowerBound(i), BucketLowerBound(i + 1))
+        std::vector<uint64_t> counts;
+
+        static size_t BucketIndex(uint64_t valueNs);
+        static uint64_t BucketLowerBound(size_t index);
+
+        double MeanNs() const { return count == 0 ? 0.0 : static_cast<double>(sumNs) / count; }
+        // Upper bound of the bucket holding the given percentile (0-100)
+        uint64_t PercentileNs(double percentile) const;
+
+        void Merge(const LatencyHistogram& other);
+    };
+
+    struct RequestMetrics {
+        // Field name of the FFIRequest message, e.g. "connect"
+        std::string type;
+        uint64_t failures = 0;
+        LatencyHistogram latency;
+    };
+
+    // Cumulative since the metrics were enabled (counters never reset, as
+    // Prometheus expects), gauges are read when the snapshot is taken.
+    struct FfiMetrics {
+        bool enabled = false;
+
+        // SendRequest: serialization, FFI call and response parsing
+        std::vector<RequestMetrics> requests;
+
+        // Events: decoding of the payloads some listener asked for, then the
+        // listeners and async completions run for each event (summed per
+        // event, including the decoding they trigger)
+        uint64_t eventsDispatched = 0;
+        uint64_t parseFailures = 0;
+        LatencyHistogram eventParse;
+        LatencyHistogram listeners;
+
+        // Event queue, when enabled (one depth per queue when pinned)
+        std::vector<size_t> queueDepths;
+        size_t queueCapacity = 0;
+        uint64_t eventsEnqueued = 0;
+        uint64_t eventsDropped = 0;
+
+        size_t pendingAsyncRequests = 0;
+    };
+}
+
+#endif /* LIVEKIT_METRICS_H */
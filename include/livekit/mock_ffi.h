@@ -0,0 +1,160 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_MOCK_FFI_H
+#define LIVEKIT_MOCK_FFI_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "livekit/event_log.h"
+#include "ffi.pb.h"
+
+// Control of the simulated FFI backend the SDK is linked against when built
+// with LIVEKIT_MOCK_FFI, in place of the Rust library. Requests are answered
+// in-process: connects succeed with a simulated room, async requests
+// complete from a thread of the backend, buffers are heap allocations owned
+// by their handle. Nothing goes to the network.
+namespace livekit
+{
+    namespace mock
+    {
+        // What connecting a room gives
+        struct SimulatedRoomOptions {
+            // Remote participants already in the room
+            size_t participants = 0;
+            size_t audioTracksPerParticipant = 1;
+            size_t videoTracksPerParticipant = 1;
+            // Before the ConnectCallback. With auto subscribe, a TrackSubscribed
+            // event follows for every remote track.
+            std::chrono::microseconds connectLatency{0};
+        };
+
+        // Applies to the rooms connecting from now on
+        void SetRoomOptions(const SimulatedRoomOptions& options);
+
+        // Rooms connected so far and not disconnected, in connection order
+        std::vector<RoomInfo> GetRooms();
+
+        // Calls the event callback on the calling thread, as the Rust side does
+        void EmitEvent(const uint8_t *data, size_t len);
+        void EmitEvent(const FFIEvent& event);
+
+        // A frame of the given video stream, in a buffer of the backend (zeroed
+        // pixels, or no planes for NATIVE)
+        void EmitVideoFrame(uint64_t streamHandle, VideoFrameBufferType type, uint32_t width, uint32_t height,
+                            int64_t timestampUs);
+
+        struct MockStats {
+            uint64_t requests = 0;
+            uint64_t eventsEmitted = 0;
+            // Owned by handles the SDK hasn't dropped yet, a steady growth
+            // over a long run is a leak
+            size_t liveHandles = 0;
+            size_t liveBytes = 0;
+        };
+        MockStats GetStats();
+
+        struct TrafficOptions {
+            // Same seed, same events
+            uint64_t seed = 1;
+            // Size of the DataReceived payloads, no data events when 0
+            size_t dataBytes = 0;
+        };
+
+        // `count` room events of the participants of `room` (mutes, active
+        // speakers, connection quality, data), one every `interval`, e.g. to
+        // feed a Replayer
+        std::vector<LoggedEvent> GenerateTraffic(const RoomInfo& room, size_t count,
+                                                 std::chrono::microseconds interval, const TrafficOptions& options = {});
+
+        struct ReplayOptions {
+            // Scales the recorded timing, 2 replays twice as fast and 0 as fast
+            // as possible
+            double speed = 1.0;
+            // When not 0, events are evenly spaced at this rate instead
+            double eventsPerSecond = 0;
+            // 0 loops until stopped
+            size_t loops = 1;
+            // When not empty, room events are moved to this room (a recording
+            // targets the room sid of the recorded session)
+            std::string roomSid;
+            // Called from the replay thread right before each event is
+            // emitted, with its index in the log and the time it was due
+            // (now when not paced), e.g. to measure the delivery latency
+            std::function<void(size_t index, std::chrono::steady_clock::time_point due)> onEmit;
+        };
+
+        // Emits logged events (see EventLogWriter) from a thread of its own, with
+        // their original timing or at a fixed rate. Frames, samples and data
+        // get fresh buffers of the backend, so the SDK can read and release
+        // them as usual; stream events keep their recorded stream handle.
+        class Replayer
+        {
+        public:
+            // Starts right away, throws std::invalid_argument if an event
+            // doesn't decode
+            explicit Replayer(const std::vector<LoggedEvent>& events, const ReplayOptions& options = {});
+            // Stops the replay
+            ~Replayer();
+
+            Replayer(const Replayer&) = delete;
+            Replayer& operator=(const Replayer&) = delete;
+
+            void Stop();
+            // Until every loop is replayed or Stop is called
+            void Wait();
+
+            uint64_t GetEmitted() const { return emitted_.load(std::memory_order_relaxed); }
+            // How far behind schedule the last event was emitted
+            std::chrono::microseconds GetLag() const {
+                return std::chrono::microseconds(lagUs_.load(std::memory_order_relaxed));
+            }
+
+        private:
+            struct Prepared {
+                std::chrono::microseconds offset;
+                // Emitted as is, unless `needsBuffers`
+                std::string bytes;
+                std::string payload;
+                bool needsBuffers = false;
+                FFIEvent event;
+            };
+
+            std::vector<Prepared> events_;
+            ReplayOptions options_;
+            std::mutex lock_;
+            std::condition_variable wakeup_;
+            bool stopped_{false};
+            bool done_{false};
+            std::atomic<uint64_t> emitted_{0};
+            std::atomic<int64_t> lagUs_{0};
+            std::thread thread_;
+
+            void Run();
+        };
+    }
+}
+
+#endif /* LIVEKIT_MOCK_FFI_H */
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_PARTICIPANT_H
+#define LIVEKIT_PARTICIPANT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "participant.pb.h"
+#include "track.pb.h"
+
+namespace livekit
+{
+    // Cached state of a published track, kept up to date by the Room
+    struct TrackPublication {
+        std::string sid;
+        std::string name;
+        TrackKind kind = TrackKind::KIND_UNKNOWN;
+        TrackSource source = TrackSource::SOURCE_UNKNOWN;
+        bool simulcasted = false;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::string mimeType;
+        bool muted = false;
+        bool remote = false;
+        bool subscribed = false;
+
+        static TrackPublication FromInfo(const TrackPublicationInfo& info);
+    };
+
+    // Cached state of a participant. It only has a few publications, they
+    // are stored inline (in no particular order).
+    struct Participant {
+        std::string sid;
+        std::string identity;
+        std::string name;
+        std::string metadata;
+        std::vector<TrackPublication> publications;
+
+        static Participant FromInfo(const ParticipantInfo& info);
+    };
+}
+
+#endif /* LIVEKIT_PARTICIPANT_H */
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_PREWARM_H
+#define LIVEKIT_PREWARM_H
+
+#include <chrono>
+#include <string>
+
+namespace livekit
+{
+    struct PrewarmOptions {
+        // Server the rooms will connect to, e.g. "wss://my.livekit.cloud".
+        // Its host name is resolved (for its port, or the scheme's default),
+        // leave empty to skip.
+        std::string url;
+    };
+
+    struct PrewarmStats {
+        // Loading the FFI and starting its runtime
+        std::chrono::microseconds ffi{0};
+        // Building the protobuf descriptors and running the event path once
+        std::chrono::microseconds protobuf{0};
+        std::chrono::microseconds dns{0};
+        // False without a url or if it didn't resolve
+        bool resolved = false;
+    };
+
+    // Does the one-time work of the first connect ahead of time, e.g. at
+    // process start while the application loads: initializes the FfiClient
+    // and the protobuf descriptors, and resolves the server's host name.
+    // The process keeps no DNS cache (glibc has none): resolving loads the
+    // resolver configuration and libraries, and warms a caching resolver
+    // (nscd, systemd-resolved) or the upstream DNS server if there is one.
+    // The TLS connections belong to the FFI, which has no way to open them
+    // early: the first connect still does its handshake. Safe to call
+    // again, it is then mostly free.
+    PrewarmStats Prewarm(const PrewarmOptions& options = {});
+}
+
+#endif /* LIVEKIT_PREWARM_H */
@@ -0,0 +1,136 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_RECORDER_H
+#define LIVEKIT_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "livekit/audio_frame.h"
+#include "livekit/ffi_client.h"
+#include "livekit/participant.h"
+#include "livekit/room.h"
+#include "livekit/video_frame.h"
+
+namespace livekit
+{
+    struct RecorderOptions {
+        // Where the segment files are created, it must exist
+        std::string directory;
+        // Segment files are preallocated to this size, and truncated to what
+        // was written when full (a frame larger than this gets its own)
+        size_t segmentBytes = 64 << 20;
+        // Frames queued for the writer beyond this are dropped
+        size_t maxBacklogBytes = 256 << 20;
+    };
+
+    struct RecorderStats {
+        // Queued for the writer, the FFI buffers of these frames are held
+        // until written
+        uint64_t backlogBytes = 0;
+        uint64_t backlogFrames = 0;
+        uint64_t writtenBytes = 0;
+        uint64_t writtenFrames = 0;
+        // Over the backlog limit, native frames that couldn't be converted,
+        // or after the writer failed
+        uint64_t droppedFrames = 0;
+        uint64_t segments = 0;
+        // A segment couldn't be created, nothing is written anymore
+        bool failed = false;
+    };
+
+    // Records frames to memory-mapped segment files from a dedicated writer
+    // thread. The Write calls only queue the frame (holding on to its FFI
+    // buffer, nothing is copied), they never wait for the disk: the writer
+    // copies the frames into the mapped segment and the kernel writes it
+    // back in the background.
+    //
+    // Segments are named segment-000001.lkr and so on. Each starts with the
+    // 8 bytes "LKREC001", followed by records: a RecordHeader, then
+    //  - kTrack: uint32 TrackKind, then the track name
+    //  - kVideo: uint32 VideoFrameBufferType, width, height, VideoRotation
+    //    and plane count, then for each plane uint32 stride, width and
+    //    height followed by stride * height bytes
+    //  - kAudio: uint32 sample rate, channel count and samples per channel,
+    //    then the interleaved int16 samples
+    // Every segment repeats the kTrack records of the tracks added so far,
+    // so it can be read on its own. Integers are in host byte order.
+    class Recorder
+    {
+    public:
+        using TrackId = uint32_t;
+
+        enum RecordType : uint16_t { kTrack = 0, kVideo = 1, kAudio = 2 };
+
+        struct RecordHeader {
+            uint32_t size;  // of what follows the header
+            uint16_t type;
+            uint16_t reserved;
+            TrackId track;
+            uint32_t padding;
+            int64_t timestampUs;
+        };
+
+        // Creates the first segment, throws if it can't
+        explicit Recorder(const RecorderOptions& options);
+        // Stops recording the room tracks, then writes the backlog out
+        ~Recorder();
+
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+        // Declares a track the frames are then written to
+        TrackId AddTrack(const std::string& name, TrackKind kind);
+
+        // Both return false if the frame was dropped. Safe to call from any
+        // thread, frames of a track must come from one thread to stay in
+        // order. Native video buffers are converted to I420 by the FFI
+        // first, on the calling thread; those it can't convert are dropped.
+        bool WriteVideo(TrackId track, const VideoFrame& frame);
+        // Audio buffers carry no timestamp, the caller provides it
+        bool WriteAudio(TrackId track, int64_t timestampUs, std::shared_ptr<const AudioFrameBuffer> buffer);
+
+        // Opens a native stream on a subscribed remote track of the room and
+        // writes its frames from the thread dispatching the stream's events.
+        // Audio frames are stamped with the steady clock on receipt.
+        TrackId RecordTrack(const Room& room, const std::string& participantSid, const TrackPublication& publication);
+        // Closes the stream, frames already queued are still written
+        void StopTrack(TrackId track);
+
+        RecorderStats GetStats() const;
+        // Shortcut to GetStats().backlogBytes, to shed load on
+        uint64_t GetBacklogBytes() const;
+
+    private:
+        // Shared with the stream listeners, which only hold it weakly
+        class Writer;
+        std::shared_ptr<Writer> writer_;
+
+        struct Stream {
+            FfiHandle handle;
+            FfiClient::ListenerId listenerId;
+        };
+        std::mutex streamsLock_;
+        std::unordered_map<TrackId, Stream> streams_;
+    };
+}
+
+#endif /* LIVEKIT_RECORDER_H */
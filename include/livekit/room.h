@@ -17,27 +17,186 @@
 #ifndef LIVEKIT_ROOM_H
 #define LIVEKIT_ROOM_H
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
 #include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
 #include "ffi.pb.h"
+#include "livekit/async_operation.h"
+#include "livekit/data_packet.h"
 #include "livekit/ffi_client.h"
+#include "livekit/participant.h"
 #include "livekit_ffi.h"
 
 namespace livekit
 {
+    // Decides whether to subscribe to a remote publication
+    using SubscriptionPolicy = std::function<bool(const Participant&, const TrackPublication&)>;
+
+    // Subscribes to the publications of a kind only, e.g. audio for a bot
+    SubscriptionPolicy SubscribeToKind(TrackKind kind);
+    // Subscribes to everything the given participants publish
+    SubscriptionPolicy SubscribeToIdentities(std::vector<std::string> identities);
+
+    struct ConnectOptions {
+        // Subscribe to every remote track as soon as it is published
+        bool autoSubscribe = true;
+        bool adaptiveStream = false;
+        bool dynacast = false;
+
+        // Replaces autoSubscribe: the publications present when connecting,
+        // then each one as it is published, are only subscribed to if the
+        // policy returns true. Runs with the other room callbacks, after the
+        // Room's cache is updated.
+        SubscriptionPolicy subscriptionPolicy;
+
+        // The room callbacks (connect handler, subscription policy, data
+        // handler, and the RoomEvents updating the cache) run in order on a
+        // strand of this executor. Without one they run on the thread
+        // dispatching the room's events.
+        Executor executor;
+    };
+
+    // How a sink renders a remote video track, see Room::AddVideoSink
+    struct VideoSinkSettings {
+        bool visible = true;
+        // Rendered size in pixels, 0 for no preference
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // Frame rate needed, 0 for the publisher's
+        uint32_t fps = 0;
+    };
+
     class Room
     {
     public:
+        using ConnectHandler = std::function<void(const ConnectCallback&)>;
+        using VideoSinkId = uint64_t;
+        // Copy the packet to keep its bytes past the call
+        using DataHandler = std::function<void(const DataPacket&)>;
+
+        Room();
+        ~Room();
+
+        Room(const Room&) = delete;
+        Room& operator=(const Room&) = delete;
+
         void Connect(const std::string& url, const std::string& token);
 
+        // `handler` runs once the connection succeeded or failed, even if the
+        // Room was destroyed in the meantime
+        void Connect(const std::string& url, const std::string& token, ConnectHandler handler);
+        void Connect(const std::string& url, const std::string& token, const ConnectOptions& options,
+                     ConnectHandler handler = nullptr);
+
+        // co_await room.ConnectAsync(url, token) suspends until the connection
+        // succeeded or failed, and resumes on `executor`
+        AsyncOperation<ConnectCallback> ConnectAsync(const std::string& url, const std::string& token,
+                                                     Executor executor = nullptr);
+        AsyncOperation<ConnectCallback> ConnectAsync(const std::string& url, const std::string& token,
+                                                     const ConnectOptions& options, Executor executor = nullptr);
+
+        // Subscribes to or unsubscribes from a remote publication, regardless
+        // of the subscription policy. Throws if not connected.
+        void SetSubscribed(const std::string& participantSid, const std::string& trackSid, bool subscribed);
+
+        // Sinks rendering a subscribed video track report what they display,
+        // so only what is visible gets sent: the track is requested at the
+        // smallest simulcast layer covering its largest visible sink (and
+        // the highest frame rate they need), and paused while none of them
+        // is visible. Requests are only sent when that outcome changes, so
+        // sinks can report their layout every frame. Throw if not connected.
+        VideoSinkId AddVideoSink(const std::string& trackSid, const VideoSinkSettings& settings = {});
+        void UpdateVideoSink(VideoSinkId id, const VideoSinkSettings& settings);
+        // The track goes back to its defaults with its last sink
+        void RemoveVideoSink(VideoSinkId id);
+
+        // Sends a data packet to the room, or to the given participants only.
+        // The FFI reads `data` in place, it only needs to stay valid for the
+        // call. Throws if not connected.
+        void PublishData(ByteSpan data, DataPacketKind kind = DataPacketKind::KIND_RELIABLE,
+                         const std::vector<std::string>& destinationSids = {});
+
+        // Coalesces the packets then sent to the whole room into one FFI call
+        // (and one data channel message) per kind and window; packets with
+        // destinations are still sent right away, possibly ahead of a pending
+        // batch. Rooms with a data handler split the batches, only enable it
+        // when every receiver is built on this SDK. Can only be enabled once.
+        void EnableDataBatching(const DataBatchOptions& options = {});
+        // Sends the pending batches now
+        void FlushData();
+
+        // Runs for each data packet received, batches split, with the other
+        // room callbacks. Can be changed at any time.
+        void SetDataHandler(DataHandler handler);
+
+        // The FFI handle of the room, INVALID_HANDLE until connected
+        uintptr_t GetHandle() const;
+
+        // Room state, cached from the ConnectCallback and kept up to date
+        // from the RoomEvents. Lookups are hash lookups on the cache and
+        // return copies, they never send an FFI request. Empty until
+        // connected.
+        std::string GetSid() const;
+        std::string GetName() const;
+        std::string GetMetadata() const;
+        Participant GetLocalParticipant() const;
+
+        // Remote participants and their publications
+        std::optional<Participant> GetParticipant(const std::string& sid) const;
+        std::optional<Participant> GetParticipantByIdentity(const std::string& identity) const;
+        std::optional<TrackPublication> GetTrackPublication(const std::string& trackSid) const;
+        std::vector<Participant> GetParticipants() const;
+        size_t GetParticipantCount() const;
+
     private:
-        mutable std::mutex lock_;
-        FfiHandle handle_{INVALID_HANDLE};
-        bool connected_{false};
-        uint64_t connectAsyncId_{0};
-        
+        // Shared with the callbacks, which only hold it weakly: the Room can
+        // be destroyed with a connect pending or while its listener runs
+        struct State;
+        std::shared_ptr<State> state_;
+    };
+
+    // One of the rooms to connect with ConnectRooms
+    struct RoomConnection {
+        Room *room;
+        std::string url;
+        std::string token;
+        ConnectOptions options;
+    };
 
-        void OnEvent(const FFIEvent& event);
+    struct BulkConnectOptions {
+        // Threads sending the connect requests, each request is a blocking
+        // FFI call
+        size_t threads = 4;
+        // Connections pending at once, 0 for no limit
+        size_t maxInFlight = 0;
+        // Rooms still connecting by then are reported as failed (they may
+        // still connect later), and those not started aren't started
+        std::chrono::milliseconds timeout{30000};
+        // Runs as each room connects or fails, from the thread delivering
+        // its callback, never after ConnectRooms returned
+        std::function<void(size_t index, const ConnectCallback&)> onConnected;
     };
+
+    struct BulkConnectResult {
+        // In the order of the rooms, with an error for the ones that timed
+        // out or couldn't be started
+        std::vector<ConnectCallback> callbacks;
+        size_t connected = 0;
+        size_t failed = 0;
+        std::chrono::milliseconds elapsed{0};
+    };
+
+    // Connects many rooms at once: the requests are sent concurrently, and
+    // the calling thread waits for all of them to complete (or for the
+    // timeout). Don't call it from the thread dispatching the events, e.g.
+    // the one calling PollEvents.
+    BulkConnectResult ConnectRooms(const std::vector<RoomConnection>& rooms, const BulkConnectOptions& options = {});
 }
 
 #endif /* LIVEKIT_ROOM_H */
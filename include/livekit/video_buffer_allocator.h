@@ -0,0 +1,78 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_VIDEO_BUFFER_ALLOCATOR_H
+#define LIVEKIT_VIDEO_BUFFER_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "livekit/video_frame.h"
+
+namespace livekit
+{
+    // Provides the buffers of a VideoFramePool, and the buffers received
+    // frames are copied into by a VideoFrameQueue (see
+    // VideoDeliveryOptions::allocator). Called from the thread acquiring the
+    // buffer, implementations must be thread-safe.
+    class VideoBufferAllocator
+    {
+    public:
+        virtual ~VideoBufferAllocator() = default;
+
+        // Throws if the buffer can't be allocated
+        virtual std::unique_ptr<VideoFrameBuffer> Allocate(VideoFrameBufferType type, uint32_t width, uint32_t height) = 0;
+    };
+
+    // Buffers allocated by the FFI, the default. Captured as is, without a copy.
+    class FfiVideoBufferAllocator : public VideoBufferAllocator
+    {
+    public:
+        std::unique_ptr<VideoFrameBuffer> Allocate(VideoFrameBufferType type, uint32_t width, uint32_t height) override;
+    };
+
+    // Buffers in memory from the given functions, e.g. cudaHostAlloc and
+    // cudaFreeHost for pinned memory the GPU can upload from directly. All
+    // the planes share a single allocation, each plane and row starting on
+    // `alignment` bytes. Capturing such a buffer costs a copy into an FFI
+    // buffer, see VideoSource::CaptureFrame.
+    class HostVideoBufferAllocator : public VideoBufferAllocator
+    {
+    public:
+        // Returns nullptr on failure
+        using AllocFn = std::function<void *(size_t size)>;
+        using FreeFn = std::function<void(void *ptr)>;
+
+        // Defaults to the aligned operator new and delete
+        explicit HostVideoBufferAllocator(size_t alignment = 64);
+        HostVideoBufferAllocator(AllocFn alloc, FreeFn free, size_t alignment = 64);
+
+        // Throws std::invalid_argument for native buffers, std::bad_alloc
+        // when `alloc` fails
+        std::unique_ptr<VideoFrameBuffer> Allocate(VideoFrameBufferType type, uint32_t width, uint32_t height) override;
+
+        size_t GetAlignment() const { return alignment_; }
+
+    private:
+        AllocFn alloc_;
+        FreeFn free_;
+        size_t alignment_;
+    };
+}
+
+#endif /* LIVEKIT_VIDEO_BUFFER_ALLOCATOR_H */
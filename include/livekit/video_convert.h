@@ -0,0 +1,67 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_VIDEO_CONVERT_H
+#define LIVEKIT_VIDEO_CONVERT_H
+
+#include <cstdint>
+
+#include "livekit/video_frame.h"
+
+namespace livekit
+{
+    // Color conversion and scaling kernels, running in-process without any
+    // FFI round-trip. They write into caller-provided buffers, so they can be
+    // used directly on the planes of a VideoFrameBuffer. The best available
+    // implementation (AVX2, SSE4.1, NEON or scalar) is picked at runtime.
+    //
+    // YUV is BT.601 limited range. Packed formats are named after their byte
+    // order in memory, except ARGB which follows libyuv/WebRTC: B, G, R, A in
+    // memory (one little-endian 0xAARRGGBB word per pixel).
+
+    void I420ToRGBA(const uint8_t *srcY, int srcStrideY,
+                    const uint8_t *srcU, int srcStrideU,
+                    const uint8_t *srcV, int srcStrideV,
+                    uint8_t *dst, int dstStride,
+                    int width, int height);
+
+    void NV12ToI420(const uint8_t *srcY, int srcStrideY,
+                    const uint8_t *srcUV, int srcStrideUV,
+                    uint8_t *dstY, int dstStrideY,
+                    uint8_t *dstU, int dstStrideU,
+                    uint8_t *dstV, int dstStrideV,
+                    int width, int height);
+
+    void ARGBToI420(const uint8_t *src, int srcStride,
+                    uint8_t *dstY, int dstStrideY,
+                    uint8_t *dstU, int dstStrideU,
+                    uint8_t *dstV, int dstStrideV,
+                    int width, int height);
+
+    // Bilinear scaling of a single 8 bits plane
+    void ScalePlane(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                    uint8_t *dst, int dstStride, int dstWidth, int dstHeight);
+
+    // Buffer overloads. `src` must be I420 (or I420A, alpha is ignored) for
+    // I420ToRGBA, NV12 for NV12ToI420, and `dst` must be I420 when it is a
+    // buffer. Throw std::invalid_argument otherwise.
+    void I420ToRGBA(const VideoFrameBuffer& src, uint8_t *dst, int dstStride);
+    void NV12ToI420(const VideoFrameBuffer& src, VideoFrameBuffer& dst);
+    void ARGBToI420(const uint8_t *src, int srcStride, VideoFrameBuffer& dst);
+    void I420Scale(const VideoFrameBuffer& src, VideoFrameBuffer& dst);
+}
+
+#endif /* LIVEKIT_VIDEO_CONVERT_H */
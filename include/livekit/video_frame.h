@@ -0,0 +1,106 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_VIDEO_FRAME_H
+#define LIVEKIT_VIDEO_FRAME_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "video_frame.pb.h"
+#include "livekit/ffi_client.h"
+
+namespace livekit
+{
+    struct VideoPlane {
+        uint8_t *data;
+        // In bytes
+        uint32_t stride;
+        // In samples
+        uint32_t width;
+        uint32_t height;
+    };
+
+    // Video buffer owned by the FFI. The planes point straight into the memory
+    // of the Rust SDK, nothing is copied, and the memory is released with the
+    // buffer handle when this object is destroyed.
+    // A buffer can also wrap memory of the application instead (pinned host
+    // memory for instance, see VideoBufferAllocator); it then has no handle.
+    class VideoFrameBuffer
+    {
+    public:
+        // Takes ownership of the buffer handle of `info`
+        explicit VideoFrameBuffer(const VideoFrameBufferInfo& info);
+        // Wraps `numPlanes` planes laid out as the FFI would for `type`, kept
+        // alive by `memory` (e.g. a shared_ptr with the matching free as
+        // deleter). Throws std::invalid_argument for native buffers, which
+        // only the FFI can create.
+        VideoFrameBuffer(VideoFrameBufferType type, uint32_t width, uint32_t height,
+                         const VideoPlane *planes, size_t numPlanes, std::shared_ptr<void> memory);
+
+        VideoFrameBuffer(const VideoFrameBuffer&) = delete;
+        VideoFrameBuffer& operator=(const VideoFrameBuffer&) = delete;
+
+        // Allocates an (uninitialized) buffer on the FFI side, e.g. to capture
+        static std::unique_ptr<VideoFrameBuffer> Allocate(VideoFrameBufferType type, uint32_t width, uint32_t height);
+
+        VideoFrameBufferType GetType() const { return type_; }
+        uint32_t GetWidth() const { return width_; }
+        uint32_t GetHeight() const { return height_; }
+        // INVALID_HANDLE for buffers in application memory
+        uintptr_t GetHandle() const { return handle_.handle; }
+
+        // A platform frame (CVPixelBuffer, D3D11 or VA surface...) that stays
+        // on the FFI side. It is passed around by handle and never converted.
+        bool IsNative() const { return type_ == VideoFrameBufferType::NATIVE; }
+
+        // Native buffers have no CPU accessible planes
+        size_t NumPlanes() const { return numPlanes_; }
+        const VideoPlane& GetPlane(size_t index) const { return planes_[index]; }
+
+        // Y, U, V, A for planar formats, Y and UV for NV12
+        const uint8_t *GetData(size_t plane) const { return planes_[plane].data; }
+        uint8_t *GetMutableData(size_t plane) { return planes_[plane].data; }
+        uint32_t GetStride(size_t plane) const { return planes_[plane].stride; }
+
+        // Copies the planes into `dst`, which must have the same type and
+        // size. Throws std::invalid_argument otherwise, or for native buffers.
+        void CopyTo(VideoFrameBuffer& dst) const;
+
+    private:
+        FfiHandle handle_;
+        std::shared_ptr<void> memory_;
+        VideoFrameBufferType type_;
+        uint32_t width_;
+        uint32_t height_;
+        size_t numPlanes_{0};
+        std::array<VideoPlane, 4> planes_{};
+    };
+
+    struct VideoFrame {
+        int64_t timestampUs;
+        VideoRotation rotation;
+        std::shared_ptr<VideoFrameBuffer> buffer;
+
+        // Takes ownership of the buffer of a received frame. Every
+        // FrameReceived must be turned into a VideoFrame (or have its buffer
+        // handle dropped), otherwise the FFI keeps the buffer alive.
+        static VideoFrame FromEvent(const FrameReceived& event);
+    };
+}
+
+#endif /* LIVEKIT_VIDEO_FRAME_H */
@@ -0,0 +1,77 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_VIDEO_FRAME_POOL_H
+#define LIVEKIT_VIDEO_FRAME_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "livekit/video_buffer_allocator.h"
+#include "livekit/video_frame.h"
+
+namespace livekit
+{
+    // Recycles FFI video buffers of a given format and resolution, e.g. for a
+    // capture loop producing a frame every 16ms. Buffers handed out by
+    // Acquire() go back to the pool, handle and memory included, once the
+    // last reference is released, instead of being dropped and reallocated.
+    // Keep a reference for as long as the FFI may read the buffer.
+    // The pool may be destroyed before its buffers.
+    class VideoFramePool
+    {
+    public:
+        // Keeps at most `maxFree` idle buffers around. Buffers come from the
+        // FFI unless an `allocator` is given.
+        VideoFramePool(VideoFrameBufferType type, uint32_t width, uint32_t height, size_t maxFree = 4,
+                       std::shared_ptr<VideoBufferAllocator> allocator = nullptr);
+
+        VideoFramePool(const VideoFramePool&) = delete;
+        VideoFramePool& operator=(const VideoFramePool&) = delete;
+
+        std::shared_ptr<VideoFrameBuffer> Acquire();
+
+        // Allocates `count` idle buffers upfront, and touches their memory so
+        // the first frames don't page fault. Never goes past `maxFree` idle
+        // buffers, `count` is reduced to fit.
+        void Reserve(size_t count);
+
+        size_t FreeCount() const;
+
+        VideoFrameBufferType GetType() const { return state_->type; }
+        uint32_t GetWidth() const { return state_->width; }
+        uint32_t GetHeight() const { return state_->height; }
+
+    private:
+        struct State {
+            VideoFrameBufferType type;
+            uint32_t width;
+            uint32_t height;
+            size_t maxFree;
+            std::shared_ptr<VideoBufferAllocator> allocator;
+
+            mutable std::mutex lock;
+            std::vector<std::unique_ptr<VideoFrameBuffer>> free;
+        };
+
+        std::shared_ptr<State> state_;
+
+        static void Release(const std::weak_ptr<State>& pool, VideoFrameBuffer *buffer);
+    };
+}
+
+#endif /* LIVEKIT_VIDEO_FRAME_POOL_H */
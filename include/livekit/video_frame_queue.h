@@ -0,0 +1,116 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_VIDEO_FRAME_QUEUE_H
+#define LIVEKIT_VIDEO_FRAME_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "livekit/ffi_client.h"
+#include "livekit/video_buffer_allocator.h"
+#include "livekit/video_frame.h"
+#include "livekit/video_frame_pool.h"
+
+namespace livekit
+{
+    enum class VideoDelivery {
+        // Only the newest frame is kept, the one it replaces is coalesced
+        LatestOnly,
+        // Up to `depth` frames, the oldest is dropped to make room
+        Bounded,
+        // Up to `depth` frames, then the thread dispatching the stream's
+        // events waits for the consumer (and so does every other event it
+        // would dispatch)
+        Block,
+    };
+
+    struct VideoDeliveryOptions {
+        VideoDelivery policy = VideoDelivery::LatestOnly;
+        size_t depth = 3;
+        // When set, received frames are copied into buffers from this
+        // allocator (recycled while the format and resolution don't change)
+        // before being queued, and the FFI buffer is released right away.
+        // Native frames are queued as they are.
+        std::shared_ptr<VideoBufferAllocator> allocator;
+    };
+
+    struct VideoDeliveryStats {
+        uint64_t received = 0;
+        uint64_t delivered = 0;
+        // Dropped by Bounded, or received once closed
+        uint64_t dropped = 0;
+        // Replaced by a newer frame under LatestOnly
+        uint64_t coalesced = 0;
+        size_t depth = 0;
+    };
+
+    // Takes the frames of a video stream off the event path, so a consumer
+    // falling behind costs frames instead of latency. The listener only
+    // queues the frame, and the consumer pops frames at its own pace.
+    // Dropped and coalesced frames are released right away, handing their
+    // buffer back to the FFI.
+    class VideoFrameQueue
+    {
+    public:
+        // Receives the frames of the stream with the given handle
+        VideoFrameQueue(uint64_t streamHandle, const VideoDeliveryOptions& options = {});
+        // Releases the queued frames, a producer blocked in Push returns
+        ~VideoFrameQueue();
+
+        VideoFrameQueue(const VideoFrameQueue&) = delete;
+        VideoFrameQueue& operator=(const VideoFrameQueue&) = delete;
+
+        std::optional<VideoFrame> TryPop();
+        std::optional<VideoFrame> WaitPop(std::chrono::milliseconds timeout = std::chrono::milliseconds::max());
+
+        // Queues a frame as if it was received, under the same policy
+        void Push(VideoFrame frame);
+
+        VideoDeliveryStats GetStats() const;
+
+    private:
+        // Shared with the listener, which only holds it weakly
+        struct State {
+            VideoDeliveryOptions options;
+            mutable std::mutex lock;
+            std::condition_variable notEmpty;
+            std::condition_variable notFull;
+            std::deque<VideoFrame> frames;
+            VideoDeliveryStats stats;
+            bool closed = false;
+
+            // Buffers received frames are copied into, with an allocator
+            std::mutex landingLock;
+            std::unique_ptr<VideoFramePool> landing;
+
+            void Push(VideoFrame frame);
+            VideoFrame Land(VideoFrame frame);
+            std::optional<VideoFrame> PopLocked();
+        };
+
+        std::shared_ptr<State> state_;
+        FfiClient::ListenerId listenerId_;
+    };
+}
+
+#endif /* LIVEKIT_VIDEO_FRAME_QUEUE_H */
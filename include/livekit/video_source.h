@@ -0,0 +1,67 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_VIDEO_SOURCE_H
+#define LIVEKIT_VIDEO_SOURCE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "livekit/ffi_client.h"
+#include "livekit/video_frame.h"
+#include "livekit/video_frame_pool.h"
+
+namespace livekit
+{
+    // Native video source, frames captured here are sent to the tracks
+    // created from it
+    class VideoSource
+    {
+    public:
+        VideoSource(uint32_t width, uint32_t height, double frameRate = 30);
+
+        VideoSource(const VideoSource&) = delete;
+        VideoSource& operator=(const VideoSource&) = delete;
+
+        // Buffers owned by the FFI, native ones included, are passed by
+        // handle: nothing is copied or converted on this side. A buffer in
+        // application memory is first copied into an FFI buffer, recycled
+        // between frames. The frame can be reused once this returns.
+        // Thread-safe.
+        void CaptureFrame(const VideoFrame& frame);
+
+        // Packed pixels the FFI reads in place while handling the request,
+        // e.g. straight from pinned or mapped memory. `format` names the
+        // byte order, as in video_convert.h.
+        void CaptureFrame(const uint8_t *data, VideoFormatType format, uint32_t stride,
+                          uint32_t width, uint32_t height, int64_t timestampUs,
+                          VideoRotation rotation = VideoRotation::VIDEO_ROTATION_0);
+
+        // To create the video track
+        uintptr_t GetHandle() const { return handle_.handle; }
+
+    private:
+        FfiHandle handle_;
+        std::mutex stagingLock_;
+        std::unique_ptr<VideoFramePool> staging_;
+
+        void Capture(FFIRequest& request);
+        std::shared_ptr<VideoFrameBuffer> Stage(const VideoFrameBuffer& buffer);
+    };
+}
+
+#endif /* LIVEKIT_VIDEO_SOURCE_H */
@@ -0,0 +1,397 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/audio_convert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "cpu_features.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+constexpr float kS16Scale = 1.0f / 32768.0f;
+
+using S16ToFloatFn = void (*)(const int16_t *src, float *dst, size_t count);
+using FloatToS16Fn = void (*)(const float *src, int16_t *dst, size_t count);
+using MixS16Fn = void (*)(const int16_t *const *sources, size_t numSources, int16_t *dst, size_t count);
+using RemixFn = void (*)(const int16_t *src, int16_t *dst, size_t frames);
+
+inline int16_t SaturateS16(int32_t value) {
+    return static_cast<int16_t>(std::min<int32_t>(std::max<int32_t>(value, INT16_MIN), INT16_MAX));
+}
+
+// Scalar kernels, also used for the tails of the SIMD ones
+
+void S16ToFloat_C(const int16_t *src, float *dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        dst[i] = src[i] * kS16Scale;
+    }
+}
+
+void FloatToS16_C(const float *src, int16_t *dst, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        // Same clamping order as the SIMD max/min, NaN ends up at -32768
+        float value = src[i] * 32768.0f;
+        value = value > -32768.0f ? value : -32768.0f;
+        value = value < 32767.0f ? value : 32767.0f;
+        dst[i] = static_cast<int16_t>(std::nearbyint(value));
+    }
+}
+
+void MixS16Tail(const int16_t *const *sources, size_t numSources, int16_t *dst, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        int32_t sum = 0;
+        for (size_t s = 0; s < numSources; ++s) {
+            sum += sources[s][i];
+        }
+        dst[i] = SaturateS16(sum);
+    }
+}
+
+void MixS16_C(const int16_t *const *sources, size_t numSources, int16_t *dst, size_t count) {
+    MixS16Tail(sources, numSources, dst, 0, count);
+}
+
+void StereoToMono_C(const int16_t *src, int16_t *dst, size_t frames) {
+    for (size_t i = 0; i < frames; ++i) {
+        dst[i] = static_cast<int16_t>((src[2 * i] + src[2 * i + 1]) >> 1);
+    }
+}
+
+void MonoToStereo_C(const int16_t *src, int16_t *dst, size_t frames) {
+    for (size_t i = 0; i < frames; ++i) {
+        dst[2 * i] = src[i];
+        dst[2 * i + 1] = src[i];
+    }
+}
+
+#if defined(LIVEKIT_X86)
+
+LIVEKIT_TARGET("sse2")
+void S16ToFloat_SSE2(const int16_t *src, float *dst, size_t count) {
+    const __m128 scale = _mm_set1_ps(kS16Scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    S16ToFloat_C(src + i, dst + i, count - i);
+}
+
+LIVEKIT_TARGET("sse2")
+void FloatToS16_SSE2(const float *src, int16_t *dst, size_t count) {
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    const __m128 minimum = _mm_set1_ps(-32768.0f);
+    const __m128 maximum = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // cvtps rounds to nearest even like nearbyint, the clamp keeps it
+        // away from the 0x80000000 "indefinite" result
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(src + i), scale);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(src + i + 4), scale);
+        a = _mm_min_ps(_mm_max_ps(a, minimum), maximum);
+        b = _mm_min_ps(_mm_max_ps(b, minimum), maximum);
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+    }
+    FloatToS16_C(src + i, dst + i, count - i);
+}
+
+LIVEKIT_TARGET("sse2")
+void MixS16_SSE2(const int16_t *const *sources, size_t numSources, int16_t *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i lo = _mm_setzero_si128();
+        __m128i hi = _mm_setzero_si128();
+        for (size_t s = 0; s < numSources; ++s) {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(sources[s] + i));
+            lo = _mm_add_epi32(lo, _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16));
+            hi = _mm_add_epi32(hi, _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(lo, hi));
+    }
+    MixS16Tail(sources, numSources, dst, i, count);
+}
+
+LIVEKIT_TARGET("sse2")
+void StereoToMono_SSE2(const int16_t *src, int16_t *dst, size_t frames) {
+    const __m128i ones = _mm_set1_epi16(1);
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i + 8));
+        __m128i sumA = _mm_srai_epi32(_mm_madd_epi16(a, ones), 1);
+        __m128i sumB = _mm_srai_epi32(_mm_madd_epi16(b, ones), 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(sumA, sumB));
+    }
+    StereoToMono_C(src + 2 * i, dst + i, frames - i);
+}
+
+LIVEKIT_TARGET("sse2")
+void MonoToStereo_SSE2(const int16_t *src, int16_t *dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i), _mm_unpacklo_epi16(x, x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i + 8), _mm_unpackhi_epi16(x, x));
+    }
+    MonoToStereo_C(src + i, dst + 2 * i, frames - i);
+}
+
+LIVEKIT_TARGET("avx2")
+void S16ToFloat_AVX2(const int16_t *src, float *dst, size_t count) {
+    const __m256 scale = _mm256_set1_ps(kS16Scale);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i lo = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)));
+        __m256i hi = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 8)));
+        _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(lo), scale));
+        _mm256_storeu_ps(dst + i + 8, _mm256_mul_ps(_mm256_cvtepi32_ps(hi), scale));
+    }
+    _mm256_zeroupper();
+    S16ToFloat_SSE2(src + i, dst + i, count - i);
+}
+
+LIVEKIT_TARGET("avx2")
+void FloatToS16_AVX2(const float *src, int16_t *dst, size_t count) {
+    const __m256 scale = _mm256_set1_ps(32768.0f);
+    const __m256 minimum = _mm256_set1_ps(-32768.0f);
+    const __m256 maximum = _mm256_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(src + i), scale);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(src + i + 8), scale);
+        a = _mm256_min_ps(_mm256_max_ps(a, minimum), maximum);
+        b = _mm256_min_ps(_mm256_max_ps(b, minimum), maximum);
+        // packs works per 128 bits lane, put the quarters back in order
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    _mm256_zeroupper();
+    FloatToS16_SSE2(src + i, dst + i, count - i);
+}
+
+LIVEKIT_TARGET("avx2")
+void MixS16_AVX2(const int16_t *const *sources, size_t numSources, int16_t *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i lo = _mm256_setzero_si256();
+        __m256i hi = _mm256_setzero_si256();
+        for (size_t s = 0; s < numSources; ++s) {
+            const __m128i *p = reinterpret_cast<const __m128i *>(sources[s] + i);
+            lo = _mm256_add_epi32(lo, _mm256_cvtepi16_epi32(_mm_loadu_si128(p)));
+            hi = _mm256_add_epi32(hi, _mm256_cvtepi16_epi32(_mm_loadu_si128(p + 1)));
+        }
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), packed);
+    }
+    _mm256_zeroupper();
+    MixS16Tail(sources, numSources, dst, i, count);
+}
+
+#elif defined(LIVEKIT_NEON)
+
+void S16ToFloat_NEON(const int16_t *src, float *dst, size_t count) {
+    const float32x4_t scale = vdupq_n_f32(kS16Scale);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), scale));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), scale));
+    }
+    S16ToFloat_C(src + i, dst + i, count - i);
+}
+
+#if defined(__aarch64__)
+void FloatToS16_NEON(const float *src, int16_t *dst, size_t count) {
+    const float32x4_t scale = vdupq_n_f32(32768.0f);
+    const float32x4_t minimum = vdupq_n_f32(-32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // vmaxnm turns NaN into the minimum like the other kernels (vcvtn
+        // alone gives 0), vcvtn rounds to nearest even, vqmovn saturates
+        int32x4_t a = vcvtnq_s32_f32(vmaxnmq_f32(vmulq_f32(vld1q_f32(src + i), scale), minimum));
+        int32x4_t b = vcvtnq_s32_f32(vmaxnmq_f32(vmulq_f32(vld1q_f32(src + i + 4), scale), minimum));
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    FloatToS16_C(src + i, dst + i, count - i);
+}
+#endif
+
+void MixS16_NEON(const int16_t *const *sources, size_t numSources, int16_t *dst, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int32x4_t lo = vdupq_n_s32(0);
+        int32x4_t hi = vdupq_n_s32(0);
+        for (size_t s = 0; s < numSources; ++s) {
+            int16x8_t x = vld1q_s16(sources[s] + i);
+            lo = vaddw_s16(lo, vget_low_s16(x));
+            hi = vaddw_s16(hi, vget_high_s16(x));
+        }
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+    MixS16Tail(sources, numSources, dst, i, count);
+}
+
+void StereoToMono_NEON(const int16_t *src, int16_t *dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t x = vld2q_s16(src + 2 * i);
+        int32x4_t lo = vshrq_n_s32(vaddl_s16(vget_low_s16(x.val[0]), vget_low_s16(x.val[1])), 1);
+        int32x4_t hi = vshrq_n_s32(vaddl_s16(vget_high_s16(x.val[0]), vget_high_s16(x.val[1])), 1);
+        vst1q_s16(dst + i, vcombine_s16(vmovn_s32(lo), vmovn_s32(hi)));
+    }
+    StereoToMono_C(src + 2 * i, dst + i, frames - i);
+}
+
+void MonoToStereo_NEON(const int16_t *src, int16_t *dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8_t x = vld1q_s16(src + i);
+        int16x8x2_t pair = {{x, x}};
+        vst2q_s16(dst + 2 * i, pair);
+    }
+    MonoToStereo_C(src + i, dst + 2 * i, frames - i);
+}
+
+#endif
+
+struct Kernels {
+    S16ToFloatFn s16ToFloat = S16ToFloat_C;
+    FloatToS16Fn floatToS16 = FloatToS16_C;
+    MixS16Fn mix = MixS16_C;
+    RemixFn stereoToMono = StereoToMono_C;
+    RemixFn monoToStereo = MonoToStereo_C;
+};
+
+Kernels SelectKernels() {
+    Kernels kernels;
+    const CpuFeatures& cpu = CpuFeatures::Get();
+    (void)cpu;
+#if defined(LIVEKIT_X86)
+    if (cpu.sse2) {
+        kernels.s16ToFloat = S16ToFloat_SSE2;
+        kernels.floatToS16 = FloatToS16_SSE2;
+        kernels.mix = MixS16_SSE2;
+        kernels.stereoToMono = StereoToMono_SSE2;
+        kernels.monoToStereo = MonoToStereo_SSE2;
+    }
+    // The remix kernels are bound by memory bandwidth, SSE2 is enough there
+    if (cpu.avx2) {
+        kernels.s16ToFloat = S16ToFloat_AVX2;
+        kernels.floatToS16 = FloatToS16_AVX2;
+        kernels.mix = MixS16_AVX2;
+    }
+#elif defined(LIVEKIT_NEON)
+    kernels.s16ToFloat = S16ToFloat_NEON;
+#if defined(__aarch64__)
+    kernels.floatToS16 = FloatToS16_NEON;
+#endif
+    kernels.mix = MixS16_NEON;
+    kernels.stereoToMono = StereoToMono_NEON;
+    kernels.monoToStereo = MonoToStereo_NEON;
+#endif
+    return kernels;
+}
+
+const Kernels& GetKernels() {
+    static const Kernels kernels = SelectKernels();
+    return kernels;
+}
+
+}
+
+void S16ToFloat(const int16_t *src, float *dst, size_t count) {
+    GetKernels().s16ToFloat(src, dst, count);
+}
+
+void FloatToS16(const float *src, int16_t *dst, size_t count) {
+    GetKernels().floatToS16(src, dst, count);
+}
+
+void RemixS16(const int16_t *src, size_t srcChannels, int16_t *dst, size_t dstChannels, size_t frames) {
+    if (srcChannels == 0 || dstChannels == 0) {
+        throw std::invalid_argument("RemixS16 needs at least one channel");
+    }
+
+    if (srcChannels == dstChannels) {
+        std::memmove(dst, src, frames * srcChannels * sizeof(int16_t));
+    } else if (srcChannels == 2 && dstChannels == 1) {
+        GetKernels().stereoToMono(src, dst, frames);
+    } else if (srcChannels == 1 && dstChannels == 2) {
+        GetKernels().monoToStereo(src, dst, frames);
+    } else if (srcChannels == 1) {
+        for (size_t i = 0; i < frames; ++i) {
+            std::fill_n(dst + i * dstChannels, dstChannels, src[i]);
+        }
+    } else if (dstChannels == 1) {
+        for (size_t i = 0; i < frames; ++i) {
+            int32_t sum = 0;
+            for (size_t c = 0; c < srcChannels; ++c) {
+                sum += src[i * srcChannels + c];
+            }
+            dst[i] = static_cast<int16_t>(sum / static_cast<int32_t>(srcChannels));
+        }
+    } else {
+        size_t common = std::min(srcChannels, dstChannels);
+        for (size_t i = 0; i < frames; ++i) {
+            const int16_t *from = src + i * srcChannels;
+            int16_t *to = dst + i * dstChannels;
+            std::copy_n(from, common, to);
+            std::fill(to + common, to + dstChannels, int16_t{0});
+        }
+    }
+}
+
+void MixS16(const int16_t *const *sources, size_t numSources, int16_t *dst, size_t count) {
+    if (numSources == 0) {
+        std::fill_n(dst, count, int16_t{0});
+        return;
+    }
+    GetKernels().mix(sources, numSources, dst, count);
+}
+
+void MixS16(const std::vector<const AudioFrameBuffer *>& sources, int16_t *dst) {
+    if (sources.empty()) {
+        return;
+    }
+
+    const AudioFrameBuffer& first = *sources.front();
+    std::vector<const int16_t *> data;
+    data.reserve(sources.size());
+    for (const AudioFrameBuffer *source : sources) {
+        if (source->GetNumChannels() != first.GetNumChannels() ||
+            source->GetSampleRate() != first.GetSampleRate() ||
+            source->GetSamplesPerChannel() != first.GetSamplesPerChannel()) {
+            throw std::invalid_argument("MixS16 expects buffers with the same format");
+        }
+        data.push_back(source->GetData());
+    }
+    GetKernels().mix(data.data(), data.size(), dst, first.GetNumSamples());
+}
+
+}
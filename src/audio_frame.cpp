@@ -0,0 +1,50 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/audio_frame.h"
+
+#include <stdexcept>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+AudioFrameBuffer::AudioFrameBuffer(const AudioFrameBufferInfo& info)
+    : handle_(info.handle().id()),
+      data_(reinterpret_cast<int16_t *>(static_cast<uintptr_t>(info.data_ptr()))),
+      numChannels_(info.num_channels()),
+      sampleRate_(info.sample_rate()),
+      samplesPerChannel_(info.samples_per_channel()) {}
+
+std::unique_ptr<AudioFrameBuffer> AudioFrameBuffer::Allocate(uint32_t sampleRate, uint32_t numChannels,
+                                                             uint32_t samplesPerChannel) {
+    AllocAudioBufferRequest *allocRequest = new AllocAudioBufferRequest;
+    allocRequest->set_sample_rate(sampleRate);
+    allocRequest->set_num_channels(numChannels);
+    allocRequest->set_samples_per_channel(samplesPerChannel);
+
+    FFIRequest request;
+    request.set_allocated_alloc_audio_buffer(allocRequest);
+
+    FFIResponse response = FfiClient::getInstance().SendRequest(request);
+    if (!response.has_alloc_audio_buffer()) {
+        throw std::runtime_error("failed to allocate an audio buffer");
+    }
+    return std::make_unique<AudioFrameBuffer>(response.alloc_audio_buffer().buffer());
+}
+
+}
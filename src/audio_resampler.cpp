@@ -0,0 +1,237 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/audio_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+#include "cpu_features.h"
+#include "livekit/audio_convert.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+constexpr uint32_t kMaxPhases = 1024;
+constexpr double kPi = 3.14159265358979323846;
+
+// Fraction of the output Nyquist frequency that is kept
+constexpr double kCutoff = 0.9;
+
+using DotFn = float (*)(const float *a, const float *b, size_t count);
+
+float Dot_C(const float *a, const float *b, size_t count) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < count; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#if defined(LIVEKIT_X86)
+
+LIVEKIT_TARGET("sse2")
+float Dot_SSE2(const float *a, const float *b, size_t count) {
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    return _mm_cvtss_f32(acc) + Dot_C(a + i, b + i, count - i);
+}
+
+LIVEKIT_TARGET("avx2")
+float Dot_AVX2(const float *a, const float *b, size_t count) {
+    // Two accumulators to hide the add latency
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    float result = _mm_cvtss_f32(sum);
+    _mm256_zeroupper();
+    return result + Dot_SSE2(a + i, b + i, count - i);
+}
+
+#elif defined(LIVEKIT_NEON)
+
+float Dot_NEON(const float *a, const float *b, size_t count) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+    float32x2_t sum = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    return vget_lane_f32(vpadd_f32(sum, sum), 0) + Dot_C(a + i, b + i, count - i);
+}
+
+#endif
+
+DotFn SelectDot() {
+    const CpuFeatures& cpu = CpuFeatures::Get();
+    (void)cpu;
+#if defined(LIVEKIT_X86)
+    if (cpu.avx2) {
+        return Dot_AVX2;
+    }
+    if (cpu.sse2) {
+        return Dot_SSE2;
+    }
+#elif defined(LIVEKIT_NEON)
+    return Dot_NEON;
+#endif
+    return Dot_C;
+}
+
+DotFn GetDot() {
+    static const DotFn dot = SelectDot();
+    return dot;
+}
+
+// Blackman windowed sinc, sampled at the upsampled rate
+std::vector<float> DesignFilter(uint32_t up, uint32_t down, uint32_t taps) {
+    size_t length = static_cast<size_t>(up) * taps;
+    double cutoff = kCutoff * 0.5 / std::max(up, down);     // cycles per upsampled sample
+    double center = (length - 1) / 2.0;
+
+    std::vector<double> prototype(length);
+    for (size_t n = 0; n < length; ++n) {
+        double t = n - center;
+        double x = 2.0 * cutoff * t;
+        double sinc = t == 0.0 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+        double window = 0.42 - 0.5 * std::cos(2.0 * kPi * n / (length - 1)) +
+                        0.08 * std::cos(4.0 * kPi * n / (length - 1));
+        // Gain of `up` makes up for the zeros inserted between the inputs
+        prototype[n] = 2.0 * cutoff * up * sinc * window;
+    }
+
+    // Phase p applies h[p + k * up] to x[i - k], store it reversed so the
+    // dot product runs forward over x[i - taps + 1 .. i]
+    std::vector<float> filter(length);
+    for (uint32_t p = 0; p < up; ++p) {
+        for (uint32_t j = 0; j < taps; ++j) {
+            filter[static_cast<size_t>(p) * taps + j] =
+                static_cast<float>(prototype[p + static_cast<size_t>(taps - 1 - j) * up]);
+        }
+    }
+    return filter;
+}
+
+}
+
+AudioResampler::AudioResampler(uint32_t inputRate, uint32_t outputRate, uint32_t numChannels, uint32_t tapsPerPhase)
+    : inputRate_(inputRate), outputRate_(outputRate), numChannels_(numChannels), taps_(tapsPerPhase) {
+    if (inputRate == 0 || outputRate == 0 || numChannels == 0 || tapsPerPhase == 0) {
+        throw std::invalid_argument("AudioResampler needs non-zero rates, channels and taps");
+    }
+
+    uint32_t divisor = std::gcd(inputRate, outputRate);
+    up_ = outputRate / divisor;
+    down_ = inputRate / divisor;
+    if (up_ > kMaxPhases) {
+        throw std::invalid_argument("AudioResampler rate ratio is too complex");
+    }
+
+    filter_ = DesignFilter(up_, down_, taps_);
+
+    // History starts out silent
+    buffer_.assign(static_cast<size_t>(numChannels_) * (taps_ - 1), 0.0f);
+    bufferFrames_ = taps_ - 1;
+}
+
+size_t AudioResampler::MaxOutputFrames(size_t inputFrames) const {
+    return (inputFrames * up_ + phase_) / down_ + 1;
+}
+
+size_t AudioResampler::Process(const int16_t *input, size_t inputFrames, int16_t *output) {
+    size_t history = taps_ - 1;
+    size_t frames = history + inputFrames;
+
+    // Grow the planar buffer keeping the history of each channel
+    if (frames > bufferFrames_) {
+        std::vector<float> grown(static_cast<size_t>(numChannels_) * frames);
+        for (uint32_t c = 0; c < numChannels_; ++c) {
+            std::copy_n(buffer_.begin() + c * bufferFrames_, history, grown.begin() + c * frames);
+        }
+        buffer_.swap(grown);
+        bufferFrames_ = frames;
+    }
+
+    // Each channel's samples go after its history, converted to float
+    if (numChannels_ == 1) {
+        S16ToFloat(input, buffer_.data() + history, inputFrames);
+    } else {
+        for (uint32_t c = 0; c < numChannels_; ++c) {
+            float *to = buffer_.data() + c * bufferFrames_ + history;
+            for (size_t i = 0; i < inputFrames; ++i) {
+                to[i] = input[i * numChannels_ + c] * (1.0f / 32768.0f);
+            }
+        }
+    }
+
+    DotFn dot = GetDot();
+    size_t written = 0;
+    float samples[8];
+    while (position_ < inputFrames) {
+        const float *taps = filter_.data() + static_cast<size_t>(phase_) * taps_;
+        for (uint32_t c = 0; c < numChannels_; c += 8) {
+            uint32_t count = std::min<uint32_t>(numChannels_ - c, 8);
+            for (uint32_t k = 0; k < count; ++k) {
+                // Window ends at input frame position_, i.e. buffer index position_ + history
+                samples[k] = dot(taps, buffer_.data() + (c + k) * bufferFrames_ + position_, taps_);
+            }
+            FloatToS16(samples, output + written * numChannels_ + c, count);
+        }
+        ++written;
+
+        phase_ += down_;
+        position_ += phase_ / up_;
+        phase_ %= up_;
+    }
+    position_ -= inputFrames;
+
+    // Keep the last taps - 1 frames for the next call
+    for (uint32_t c = 0; c < numChannels_; ++c) {
+        float *channel = buffer_.data() + c * bufferFrames_;
+        std::copy(channel + inputFrames, channel + inputFrames + history, channel);
+    }
+    return written;
+}
+
+size_t AudioResampler::Process(const AudioFrameBuffer& input, int16_t *output) {
+    if (input.GetSampleRate() != inputRate_ || input.GetNumChannels() != numChannels_) {
+        throw std::invalid_argument("AudioResampler input doesn't match its rate or channels");
+    }
+    return Process(input.GetData(), input.GetSamplesPerChannel(), output);
+}
+
+}
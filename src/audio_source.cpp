@@ -0,0 +1,109 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/audio_source.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+#include "livekit/audio_frame.h"
+#include "spsc_ring.h"
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+uintptr_t NewAudioSource(uint32_t sampleRate, uint32_t numChannels) {
+    if (sampleRate == 0 || sampleRate % 100 != 0 || numChannels == 0) {
+        throw std::invalid_argument("the sample rate must be a multiple of 100Hz, with at least one channel");
+    }
+
+    NewAudioSourceRequest *sourceRequest = new NewAudioSourceRequest;
+    sourceRequest->set_type(AudioSourceType::AUDIO_SOURCE_NATIVE);
+
+    FFIRequest request;
+    request.set_allocated_new_audio_source(sourceRequest);
+
+    FFIResponse response = FfiClient::getInstance().SendRequest(request);
+    if (!response.has_new_audio_source()) {
+        throw std::runtime_error("failed to create the audio source");
+    }
+    return response.new_audio_source().source().handle().id();
+}
+
+}
+
+AudioSource::AudioSource(uint32_t sampleRate, uint32_t numChannels, uint32_t queueMs)
+    : handle_(NewAudioSource(sampleRate, numChannels)), sampleRate_(sampleRate), numChannels_(numChannels),
+      ring_(std::make_unique<SpscRing<int16_t>>(static_cast<size_t>(sampleRate) * numChannels * queueMs / 1000)) {
+    thread_ = std::thread(&AudioSource::Run, this);
+}
+
+AudioSource::~AudioSource() {
+    running_.store(false, std::memory_order_relaxed);
+    thread_.join();
+}
+
+size_t AudioSource::CaptureFrame(const int16_t *data, size_t samplesPerChannel) {
+    // Only queue whole frames
+    size_t frames = std::min(samplesPerChannel, ring_->Space() / numChannels_);
+    ring_->Write(data, frames * numChannels_);
+
+    if (frames < samplesPerChannel) {
+        dropped_.fetch_add(samplesPerChannel - frames, std::memory_order_relaxed);
+    }
+    return frames;
+}
+
+void AudioSource::Run() {
+    // The FFI copies the samples while handling the capture request, so the
+    // same buffer and request are used for every frame
+    const size_t frameSamples = static_cast<size_t>(sampleRate_ / 100) * numChannels_;
+    std::unique_ptr<AudioFrameBuffer> buffer;
+    try {
+        buffer = AudioFrameBuffer::Allocate(sampleRate_, numChannels_, sampleRate_ / 100);
+    } catch (const std::exception& e) {
+        std::cerr << "audio source stopped: " << e.what() << std::endl;
+        return;
+    }
+
+    FFIRequest request;
+    CaptureAudioFrameRequest *captureRequest = request.mutable_capture_audio_frame();
+    captureRequest->mutable_source_handle()->set_id(handle_.handle);
+    captureRequest->mutable_buffer_handle()->set_id(buffer->GetHandle());
+    FFIResponse response;
+
+    FfiClient& client = FfiClient::getInstance();
+    while (running_.load(std::memory_order_relaxed)) {
+        while (ring_->Available() >= frameSamples) {
+            ring_->Read(buffer->GetData(), frameSamples);
+            try {
+                client.SendRequest(request, response);
+            } catch (const std::exception& e) {
+                std::cerr << "failed to capture an audio frame: " << e.what() << std::endl;
+            }
+        }
+
+        // Half a frame, the producer can't wake us up without locking
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+}
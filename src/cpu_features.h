@@ -0,0 +1,85 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_CPU_FEATURES_H
+#define LIVEKIT_CPU_FEATURES_H
+
+// Runtime CPU detection for the SIMD kernels. x86 kernels are compiled with
+// per-function target attributes, so the SDK doesn't need to be built with
+// -mavx2 and still runs on older CPUs. NEON is part of the ARMv8 baseline.
+//
+// The rest of the SDK is legacy SSE code: AVX2 kernels must end with
+// _mm256_zeroupper() before calling their SSE/scalar tail or returning, or
+// the following SSE instructions run many times slower on the dirty state.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define LIVEKIT_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define LIVEKIT_TARGET(features)
+#else
+#define LIVEKIT_TARGET(features) __attribute__((target(features)))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define LIVEKIT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace livekit
+{
+    struct CpuFeatures {
+        bool sse2 = false;
+        bool sse41 = false;
+        bool avx2 = false;
+        bool neon = false;
+
+        static const CpuFeatures& Get() {
+            static const CpuFeatures features = Detect();
+            return features;
+        }
+
+    private:
+        static CpuFeatures Detect() {
+            CpuFeatures features;
+#if defined(LIVEKIT_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            int maxLeaf = info[0];
+            __cpuid(info, 1);
+            features.sse2 = (info[3] & (1 << 26)) != 0;
+            features.sse41 = (info[2] & (1 << 19)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6) {
+                __cpuidex(info, 7, 0);
+                features.avx2 = (info[1] & (1 << 5)) != 0;
+            }
+#else
+            __builtin_cpu_init();
+            features.sse2 = __builtin_cpu_supports("sse2");
+            features.sse41 = __builtin_cpu_supports("sse4.1");
+            features.avx2 = __builtin_cpu_supports("avx2");
+#endif
+#elif defined(LIVEKIT_NEON)
+            features.neon = true;
+#endif
+            return features;
+        }
+    };
+}
+
+#endif /* LIVEKIT_CPU_FEATURES_H */
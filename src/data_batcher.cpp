@@ -0,0 +1,211 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "data_batcher.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace livekit
+{
+
+namespace
+{
+
+size_t VarintSize(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+void AppendVarint(std::vector<uint8_t>& bytes, uint64_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+bool ReadVarint(const uint8_t *&pos, const uint8_t *end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7) {
+        uint8_t byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+constexpr uint8_t DataBatcher::kMagic[];
+
+DataBatcher::DataBatcher(const DataBatchOptions& options, Send send) : options_(options), send_(std::move(send)) {
+    if (options_.maxBytes <= sizeof(kMagic) + 1) {
+        throw std::invalid_argument("data batches need room for a packet");
+    }
+    thread_ = std::thread([this]() { Run(); });
+}
+
+DataBatcher::~DataBatcher() {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stopped_ = true;
+    }
+    wakeup_.notify_one();
+    thread_.join();
+
+    std::lock_guard<std::mutex> guard(lock_);
+    for (size_t index = 0; index < kKinds; ++index) {
+        try {
+            SendLocked(index);
+        } catch (const std::exception& e) {
+            std::cerr << "failed to send a data batch: " << e.what() << std::endl;
+        }
+    }
+}
+
+void DataBatcher::Publish(ByteSpan data, DataPacketKind kind) {
+    size_t index = Index(kind);
+    size_t framed = VarintSize(data.size) + data.size;
+
+    std::lock_guard<std::mutex> guard(lock_);
+    Batch& batch = batches_[index];
+    if (sizeof(kMagic) + framed > options_.maxBytes) {
+        SendLocked(index);
+        if (!StartsWithMagic(data)) {
+            send_(data, kind);
+            return;
+        }
+        // Receivers would take it for a batch, send it as one
+        std::vector<uint8_t> bytes(kMagic, kMagic + sizeof(kMagic));
+        bytes.reserve(sizeof(kMagic) + framed);
+        AppendVarint(bytes, data.size);
+        bytes.insert(bytes.end(), data.begin(), data.end());
+        send_(ByteSpan(bytes), kind);
+        return;
+    }
+    if (batch.bytes.size() + framed > options_.maxBytes) {
+        SendLocked(index);
+    }
+
+    bool first = batch.count == 0;
+    if (first) {
+        batch.bytes.assign(kMagic, kMagic + sizeof(kMagic));
+        batch.deadline = std::chrono::steady_clock::now() + options_.window;
+    }
+    AppendVarint(batch.bytes, data.size);
+    if (first) {
+        batch.firstOffset = batch.bytes.size();
+    }
+    batch.bytes.insert(batch.bytes.end(), data.begin(), data.end());
+    ++batch.count;
+
+    if (first) {
+        wakeup_.notify_one();
+    }
+}
+
+void DataBatcher::Flush() {
+    std::lock_guard<std::mutex> guard(lock_);
+    for (size_t index = 0; index < kKinds; ++index) {
+        SendLocked(index);
+    }
+}
+
+bool DataBatcher::Split(ByteSpan data, std::vector<ByteSpan>& packets) {
+    packets.clear();
+    if (data.size <= sizeof(kMagic) || std::memcmp(data.data, kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+
+    const uint8_t *pos = data.data + sizeof(kMagic);
+    const uint8_t *end = data.end();
+    while (pos < end) {
+        uint64_t size;
+        if (!ReadVarint(pos, end, size) || size > static_cast<uint64_t>(end - pos)) {
+            packets.clear();
+            return false;
+        }
+        packets.emplace_back(pos, static_cast<size_t>(size));
+        pos += size;
+    }
+    return true;
+}
+
+// Called with the lock held. The batch is emptied even if sending throws.
+void DataBatcher::SendLocked(size_t index) {
+    Batch& batch = batches_[index];
+    if (batch.count == 0) {
+        return;
+    }
+
+    struct Clear {
+        Batch& batch;
+        ~Clear() {
+            batch.count = 0;
+            batch.bytes.clear();
+        }
+    } clear{batch};
+
+    ByteSpan first(batch.bytes.data() + batch.firstOffset, batch.bytes.size() - batch.firstOffset);
+    if (batch.count == 1 && !StartsWithMagic(first)) {
+        send_(first, Kind(index));
+    } else {
+        send_(ByteSpan(batch.bytes), Kind(index));
+    }
+}
+
+bool DataBatcher::StartsWithMagic(ByteSpan data) {
+    return data.size >= sizeof(kMagic) && std::memcmp(data.data, kMagic, sizeof(kMagic)) == 0;
+}
+
+void DataBatcher::Run() {
+    std::unique_lock<std::mutex> guard(lock_);
+    while (!stopped_) {
+        std::chrono::steady_clock::time_point next = std::chrono::steady_clock::time_point::max();
+        for (const Batch& batch : batches_) {
+            if (batch.count != 0) {
+                next = std::min(next, batch.deadline);
+            }
+        }
+        if (next == std::chrono::steady_clock::time_point::max()) {
+            wakeup_.wait(guard);
+        } else {
+            wakeup_.wait_until(guard, next);
+        }
+
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        for (size_t index = 0; index < kKinds; ++index) {
+            if (batches_[index].count != 0 && batches_[index].deadline <= now) {
+                try {
+                    SendLocked(index);
+                } catch (const std::exception& e) {
+                    std::cerr << "failed to send a data batch: " << e.what() << std::endl;
+                }
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_DATA_BATCHER_H
+#define LIVEKIT_DATA_BATCHER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "livekit/data_packet.h"
+#include "room.pb.h"
+
+namespace livekit
+{
+    // Coalesces the small packets published within a window into one
+    // packet, one batch per kind. A batch is the magic prefix followed by
+    // each packet as a varint length and its bytes; a batch of a single
+    // packet is sent as the packet itself, unless the packet starts with
+    // the prefix. The prefix starts with 0xFF, which neither UTF-8 text nor
+    // a protobuf message can start with.
+    class DataBatcher
+    {
+    public:
+        using Send = std::function<void(ByteSpan data, DataPacketKind kind)>;
+
+        static constexpr uint8_t kMagic[] = {0xFF, 'L', 'K', 'B'};
+
+        DataBatcher(const DataBatchOptions& options, Send send);
+        // Sends what is pending
+        ~DataBatcher();
+
+        DataBatcher(const DataBatcher&) = delete;
+        DataBatcher& operator=(const DataBatcher&) = delete;
+
+        // Copies `data` into the batch of its kind, or sends it right away
+        // (after that batch, to keep the order) if it is too large to share
+        void Publish(ByteSpan data, DataPacketKind kind);
+        void Flush();
+
+        // Splits a batch into its packets, which point into `data`. Returns
+        // false, leaving `packets` empty, if `data` isn't a well-formed batch.
+        static bool Split(ByteSpan data, std::vector<ByteSpan>& packets);
+
+    private:
+        struct Batch {
+            std::vector<uint8_t> bytes;
+            size_t count = 0;
+            size_t firstOffset = 0;  // of the first packet's bytes
+            std::chrono::steady_clock::time_point deadline;
+        };
+
+        static constexpr size_t kKinds = 2;
+
+        DataBatchOptions options_;
+        Send send_;
+        // Held while sending, which keeps the packets in order
+        std::mutex lock_;
+        std::condition_variable wakeup_;
+        Batch batches_[kKinds];
+        bool stopped_{false};
+        std::thread thread_;
+
+        static size_t Index(DataPacketKind kind) { return kind == DataPacketKind::KIND_LOSSY ? 0 : 1; }
+        static DataPacketKind Kind(size_t index) {
+            return index == 0 ? DataPacketKind::KIND_LOSSY : DataPacketKind::KIND_RELIABLE;
+        }
+
+        static bool StartsWithMagic(ByteSpan data);
+        void SendLocked(size_t index);
+        void Run();
+    };
+}
+
+#endif /* LIVEKIT_DATA_BATCHER_H */
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/event_log.h"
+
+#include <stdexcept>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+void PutLE(std::ofstream& file, uint64_t value, size_t bytes) {
+    char out[8];
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+    file.write(out, static_cast<std::streamsize>(bytes));
+}
+
+bool GetLE(std::ifstream& file, uint64_t& value, size_t bytes) {
+    unsigned char in[8];
+    if (!file.read(reinterpret_cast<char *>(in), static_cast<std::streamsize>(bytes))) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return true;
+}
+
+bool GetString(std::ifstream& file, std::string& out) {
+    uint64_t size;
+    if (!GetLE(file, size, 4)) {
+        return false;
+    }
+    out.resize(size);
+    return size == 0 || file.read(&out[0], static_cast<std::streamsize>(size));
+}
+
+}
+
+EventLogWriter::EventLogWriter(const std::string& path) : state_(std::make_shared<State>()) {
+    state_->file.open(path, std::ios::binary | std::ios::trunc);
+    if (!state_->file) {
+        throw std::runtime_error("failed to create the event log " + path);
+    }
+    // Broadcast listeners run before the room ones, which may release the
+    // data buffers
+    std::weak_ptr<State> weak = state_;
+    listenerId_ = FfiClient::getInstance().AddListener([weak](const FFIEvent& event) {
+        if (std::shared_ptr<State> state = weak.lock()) {
+            state->Append(event);
+        }
+    });
+}
+
+EventLogWriter::~EventLogWriter() {
+    FfiClient::getInstance().RemoveListener(listenerId_);
+    std::lock_guard<std::mutex> guard(state_->lock);
+    state_->closed = true;
+    state_->file.flush();
+}
+
+uint64_t EventLogWriter::GetEventCount() const {
+    std::lock_guard<std::mutex> guard(state_->lock);
+    return state_->count;
+}
+
+void EventLogWriter::State::Append(const FFIEvent& event) {
+    std::string bytes = event.SerializeAsString();
+    std::string payload;
+    if (event.has_room_event() && event.room_event().has_data_received()) {
+        const DataReceived& data = event.room_event().data_received();
+        payload.assign(reinterpret_cast<const char *>(static_cast<uintptr_t>(data.data_ptr())), data.data_size());
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> guard(lock);
+    if (closed) {
+        return;
+    }
+    if (!started) {
+        start = now;
+        started = true;
+    }
+    auto offset = std::chrono::duration_cast<std::chrono::microseconds>(now - start);
+    PutLE(file, static_cast<uint64_t>(offset.count()), 8);
+    PutLE(file, bytes.size(), 4);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    PutLE(file, payload.size(), 4);
+    file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+    ++count;
+}
+
+std::vector<LoggedEvent> ReadEventLog(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("failed to open the event log " + path);
+    }
+
+    std::vector<LoggedEvent> events;
+    uint64_t offset;
+    while (GetLE(file, offset, 8)) {
+        LoggedEvent event;
+        event.offset = std::chrono::microseconds(static_cast<int64_t>(offset));
+        if (!GetString(file, event.bytes) || !GetString(file, event.payload)) {
+            throw std::runtime_error("truncated event log " + path);
+        }
+        events.push_back(std::move(event));
+    }
+    if (file.gcount() != 0) {
+        throw std::runtime_error("truncated event log " + path);
+    }
+    if (!file.eof()) {
+        throw std::runtime_error("failed to read the event log " + path);
+    }
+    return events;
+}
+
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "event_peek.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+using google::protobuf::io::CodedInputStream;
+using google::protobuf::internal::WireFormatLite;
+
+// Skips the fields of the current message up to `field`, a length-delimited
+// one, and limits the stream to its payload
+bool EnterField(CodedInputStream& input, int field) {
+    while (uint32_t tag = input.ReadTag()) {
+        if (WireFormatLite::GetTagFieldNumber(tag) == field &&
+            WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+            int size;
+            if (!input.ReadVarintSizeAsInt(&size)) {
+                return false;
+            }
+            input.PushLimit(size);
+            return true;
+        }
+        if (!WireFormatLite::SkipField(&input, tag)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// The input is one flat buffer, so the string is viewed in place
+bool ReadStringField(CodedInputStream& input, int field, std::string_view& value) {
+    if (!EnterField(input, field)) {
+        return false;
+    }
+    const void *data = nullptr;
+    int size = 0;
+    if (!input.GetDirectBufferPointer(&data, &size)) {
+        size = 0;
+    }
+    value = std::string_view(static_cast<const char *>(data), size);
+    return true;
+}
+
+bool HashStringField(CodedInputStream& input, int field, uint64_t& hash) {
+    std::string_view value;
+    if (!ReadStringField(input, field, value)) {
+        return false;
+    }
+    hash = RoomAffinity(value);
+    return true;
+}
+
+// FFIHandleId and FFIAsyncId messages, both hold a single id
+bool ReadIdField(CodedInputStream& input, int field, uint64_t& id) {
+    static_assert(static_cast<int>(FFIHandleId::kIdFieldNumber) == static_cast<int>(FFIAsyncId::kIdFieldNumber), "ids are read the same way");
+    if (!EnterField(input, field)) {
+        return false;
+    }
+    while (uint32_t tag = input.ReadTag()) {
+        if (WireFormatLite::GetTagFieldNumber(tag) == FFIHandleId::kIdFieldNumber &&
+            WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_VARINT) {
+            return input.ReadVarint64(&id);
+        }
+        if (!WireFormatLite::SkipField(&input, tag)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+// FFIEvent is a single oneof, its first field is the whole message. Returns
+// its field number with the stream limited to it, or 0.
+int EnterEvent(CodedInputStream& input, size_t len) {
+    uint32_t tag = input.ReadTag();
+    if (WireFormatLite::GetTagWireType(tag) != WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+        return 0;
+    }
+    int size;
+    if (!input.ReadVarintSizeAsInt(&size) || static_cast<size_t>(input.CurrentPosition()) + size > len) {
+        return 0;
+    }
+    input.PushLimit(size);
+    return WireFormatLite::GetTagFieldNumber(tag);
+}
+
+bool IsEventCase(int field) {
+    static const std::vector<bool> cases = []() {
+        std::vector<bool> known;
+        const google::protobuf::OneofDescriptor *oneof = FFIEvent::descriptor()->FindOneofByName("message");
+        for (int i = 0; oneof != nullptr && i < oneof->field_count(); ++i) {
+            size_t number = static_cast<size_t>(oneof->field(i)->number());
+            known.resize(std::max(known.size(), number + 1));
+            known[number] = true;
+        }
+        return known;
+    }();
+    return static_cast<size_t>(field) < cases.size() && cases[field];
+}
+
+}
+
+bool PeekEventHeader(const uint8_t *data, size_t len, EventHeader& header) {
+    header = EventHeader{};
+    if (len == 0) {
+        return true;
+    }
+
+    CodedInputStream input(data, static_cast<int>(len));
+    int field = EnterEvent(input, len);
+    if (field == 0) {
+        return false;
+    }
+    if (!IsEventCase(field)) {
+        // Unknown to this version of the protocol, like the parser does
+        return true;
+    }
+
+    header.type = static_cast<FFIEvent::MessageCase>(field);
+    switch (field) {
+        case FFIEvent::kRoomEventFieldNumber:
+            ReadStringField(input, RoomEvent::kRoomSidFieldNumber, header.roomSid);
+            break;
+        case FFIEvent::kVideoStreamEventFieldNumber:
+            ReadIdField(input, VideoStreamEvent::kHandleFieldNumber, header.handleId);
+            break;
+        case FFIEvent::kAudioStreamEventFieldNumber:
+            ReadIdField(input, AudioStreamEvent::kHandleFieldNumber, header.handleId);
+            break;
+        case FFIEvent::kConnectFieldNumber:
+            ReadIdField(input, ConnectCallback::kAsyncIdFieldNumber, header.asyncId);
+            break;
+        case FFIEvent::kDisconnectFieldNumber:
+            ReadIdField(input, DisconnectCallback::kAsyncIdFieldNumber, header.asyncId);
+            break;
+        case FFIEvent::kDisposeFieldNumber:
+            ReadIdField(input, DisposeCallback::kAsyncIdFieldNumber, header.asyncId);
+            break;
+        case FFIEvent::kPublishTrackFieldNumber:
+            ReadIdField(input, PublishTrackCallback::kAsyncIdFieldNumber, header.asyncId);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+bool PeekEventAffinity(const uint8_t *data, size_t len, uint64_t& affinity) {
+    CodedInputStream input(data, static_cast<int>(len));
+
+    switch (EnterEvent(input, len)) {
+        case FFIEvent::kRoomEventFieldNumber:
+            return HashStringField(input, RoomEvent::kRoomSidFieldNumber, affinity);
+        case FFIEvent::kConnectFieldNumber:
+            // Lands with the room's events, so they never overtake it
+            return EnterField(input, ConnectCallback::kRoomFieldNumber) &&
+                   HashStringField(input, RoomInfo::kSidFieldNumber, affinity);
+        case FFIEvent::kVideoStreamEventFieldNumber:
+            return ReadIdField(input, VideoStreamEvent::kHandleFieldNumber, affinity);
+        case FFIEvent::kAudioStreamEventFieldNumber:
+            return ReadIdField(input, AudioStreamEvent::kHandleFieldNumber, affinity);
+        default:
+            return false;
+    }
+}
+
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_EVENT_PEEK_H
+#define LIVEKIT_EVENT_PEEK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+    // Oneof case of an encoded FFIEvent and the fields it is routed on
+    struct EventHeader {
+        FFIEvent::MessageCase type = FFIEvent::MESSAGE_NOT_SET;
+        uint64_t asyncId = 0;
+        uint64_t handleId = 0;
+        std::string_view roomSid;   // points into the encoded event
+    };
+
+    // Decodes the header of an encoded FFIEvent, reading no further than
+    // the routing fields. Missing fields are left at their default, returns
+    // false if the event itself isn't framed properly.
+    bool PeekEventHeader(const uint8_t *data, size_t len, EventHeader& header);
+
+    // Finds what an encoded FFIEvent is bound to without decoding it, so the
+    // FFI callback can pick a dispatcher shard without parsing or allocating:
+    // the room sid of RoomEvents and ConnectCallbacks, the stream handle of
+    // stream events. Returns false for anything else (or malformed input).
+    bool PeekEventAffinity(const uint8_t *data, size_t len, uint64_t& affinity);
+
+    // Affinity of the events of a room, as returned by PeekEventAffinity
+    inline uint64_t RoomAffinity(std::string_view roomSid) {
+        return std::hash<std::string_view>{}(roomSid);
+    }
+}
+
+#endif /* LIVEKIT_EVENT_PEEK_H */
@@ -0,0 +1,188 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_EVENT_QUEUE_H
+#define LIVEKIT_EVENT_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace livekit
+{
+    // Bounded queue of raw event bytes (Vyukov's bounded MPMC ring).
+    // Push and pop are lock-free; the mutex is only taken to wake up consumers
+    // that went to sleep on an empty queue.
+    // Slots keep their buffers, and popping swaps the caller's buffer into the
+    // slot, so once warmed up the queue does not allocate.
+    class EventQueue
+    {
+    public:
+        explicit EventQueue(size_t capacity) : capacity_(RoundUp(capacity)), slots_(new Slot[capacity_]) {
+            for (size_t i = 0; i < capacity_; ++i) {
+                slots_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        EventQueue(const EventQueue&) = delete;
+        EventQueue& operator=(const EventQueue&) = delete;
+
+        // Returns false (and counts a drop) if the queue is full
+        bool TryPush(const uint8_t *data, size_t len) {
+            size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+            Slot *slot;
+            for (;;) {
+                slot = &slots_[pos & (capacity_ - 1)];
+                size_t seq = slot->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->data.assign(data, data + len);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+            enqueued_.fetch_add(1, std::memory_order_relaxed);
+
+            // Pairs with the fence in WaitPop, see there
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleepers_.load(std::memory_order_relaxed) > 0) {
+                std::lock_guard<std::mutex> guard(lock_);
+                cv_.notify_one();
+            }
+            return true;
+        }
+
+        // Swaps the oldest event into `out`, returns false if the queue is empty
+        bool TryPop(std::vector<uint8_t>& out) {
+            size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+            Slot *slot;
+            for (;;) {
+                slot = &slots_[pos & (capacity_ - 1)];
+                size_t seq = slot->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    return false;
+                } else {
+                    pos = dequeuePos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            out.swap(slot->data);
+            slot->sequence.store(pos + capacity_, std::memory_order_release);
+            return true;
+        }
+
+        // Blocks until an event is available or Close() is called
+        bool WaitPop(std::vector<uint8_t>& out) {
+            return WaitPopUntil(out, std::chrono::steady_clock::time_point::max());
+        }
+
+        // Same as WaitPop, giving up at `deadline`
+        bool WaitPopUntil(std::vector<uint8_t>& out, std::chrono::steady_clock::time_point deadline) {
+            for (;;) {
+                if (TryPop(out)) {
+                    return true;
+                }
+
+                std::unique_lock<std::mutex> guard(lock_);
+                if (closed_) {
+                    return TryPop(out);
+                }
+
+                sleepers_.fetch_add(1, std::memory_order_relaxed);
+                // Either the producer sees us sleeping, or we see its event
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!Empty()) {
+                    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                    continue;
+                }
+                bool timeout = deadline == std::chrono::steady_clock::time_point::max()
+                    ? (cv_.wait(guard), false)
+                    : cv_.wait_until(guard, deadline) == std::cv_status::timeout;
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                if (timeout) {
+                    return TryPop(out);
+                }
+            }
+        }
+
+        // Wakes up every consumer blocked in WaitPop
+        void Close() {
+            std::lock_guard<std::mutex> guard(lock_);
+            closed_ = true;
+            cv_.notify_all();
+        }
+
+        bool Empty() const {
+            return Depth() == 0;
+        }
+
+        size_t Depth() const {
+            size_t enqueue = enqueuePos_.load(std::memory_order_relaxed);
+            size_t dequeue = dequeuePos_.load(std::memory_order_relaxed);
+            return enqueue > dequeue ? enqueue - dequeue : 0;
+        }
+
+        size_t Capacity() const { return capacity_; }
+        uint64_t Enqueued() const { return enqueued_.load(std::memory_order_relaxed); }
+        uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<size_t> sequence;
+            std::vector<uint8_t> data;
+        };
+
+        static size_t RoundUp(size_t capacity) {
+            size_t size = 2;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        const size_t capacity_;
+        std::unique_ptr<Slot[]> slots_;
+
+        alignas(64) std::atomic<size_t> enqueuePos_{0};
+        alignas(64) std::atomic<size_t> dequeuePos_{0};
+        alignas(64) std::atomic<uint64_t> enqueued_{0};
+        std::atomic<uint64_t> dropped_{0};
+
+        std::atomic<int> sleepers_{0};
+        std::mutex lock_;
+        std::condition_variable cv_;
+        bool closed_{false};
+    };
+}
+
+#endif /* LIVEKIT_EVENT_QUEUE_H */
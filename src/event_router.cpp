@@ -0,0 +1,180 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "event_router.h"
+
+#include <stdexcept>
+
+#include "tracer.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+using ListenerList = std::vector<std::pair<FfiClient::ListenerId, FfiClient::ViewListener>>;
+using SharedList = std::shared_ptr<const ListenerList>;
+
+SharedList Appended(const SharedList& current, FfiClient::ListenerId id, const FfiClient::ViewListener& listener) {
+    auto list = current ? std::make_shared<ListenerList>(*current) : std::make_shared<ListenerList>();
+    list->emplace_back(id, listener);
+    return list;
+}
+
+// Returns null once the last listener is gone
+SharedList Without(const SharedList& current, FfiClient::ListenerId id) {
+    if (!current) {
+        return nullptr;
+    }
+
+    auto list = std::make_shared<ListenerList>();
+    list->reserve(current->size());
+    for (const auto& entry : *current) {
+        if (entry.first != id) {
+            list->push_back(entry);
+        }
+    }
+    return list->empty() ? nullptr : SharedList(std::move(list));
+}
+
+template<typename Key>
+using ListenerMap = std::unordered_map<Key, SharedList>;
+
+template<typename Key>
+std::shared_ptr<const ListenerMap<Key>> Inserted(const std::shared_ptr<const ListenerMap<Key>>& current, const Key& key,
+                                                 FfiClient::ListenerId id, const FfiClient::ViewListener& listener) {
+    auto map = current ? std::make_shared<ListenerMap<Key>>(*current) : std::make_shared<ListenerMap<Key>>();
+    SharedList& list = (*map)[key];
+    list = Appended(list, id, listener);
+    return map;
+}
+
+// Returns null once the last list is gone
+template<typename Key>
+std::shared_ptr<const ListenerMap<Key>> Erased(const std::shared_ptr<const ListenerMap<Key>>& current, const Key& key,
+                                               FfiClient::ListenerId id) {
+    if (!current || current->find(key) == current->end()) {
+        return current;
+    }
+
+    auto map = std::make_shared<ListenerMap<Key>>(*current);
+    auto it = map->find(key);
+    if (SharedList list = Without(it->second, id)) {
+        it->second = std::move(list);
+    } else {
+        map->erase(it);
+    }
+    return map->empty() ? nullptr : std::shared_ptr<const ListenerMap<Key>>(std::move(map));
+}
+
+}
+
+EventRouter EventRouter::WithListener(ListenerId id, const EventSubscription& subscription,
+                                      const Listener& listener) const {
+    EventRouter router = *this;
+    switch (subscription.kind) {
+        case EventSubscription::Kind::All:
+            router.broadcast_ = Appended(broadcast_, id, listener);
+            break;
+        case EventSubscription::Kind::Type: {
+            size_t type = static_cast<size_t>(subscription.type);
+            if (type >= kMaxEventTypes) {
+                throw std::invalid_argument("unknown event type");
+            }
+            router.byType_[type] = Appended(byType_[type], id, listener);
+            break;
+        }
+        case EventSubscription::Kind::AsyncId:
+            router.byAsyncId_ = Inserted(byAsyncId_, subscription.id, id, listener);
+            break;
+        case EventSubscription::Kind::Handle:
+            router.byHandle_ = Inserted(byHandle_, subscription.id, id, listener);
+            break;
+        case EventSubscription::Kind::Room:
+            router.byRoom_ = Inserted(byRoom_, subscription.roomSid, id, listener);
+            break;
+    }
+    return router;
+}
+
+EventRouter EventRouter::WithoutListener(ListenerId id, const EventSubscription& subscription) const {
+    EventRouter router = *this;
+    switch (subscription.kind) {
+        case EventSubscription::Kind::All:
+            router.broadcast_ = Without(broadcast_, id);
+            break;
+        case EventSubscription::Kind::Type: {
+            size_t type = static_cast<size_t>(subscription.type);
+            router.byType_[type] = Without(byType_[type], id);
+            break;
+        }
+        case EventSubscription::Kind::AsyncId:
+            router.byAsyncId_ = Erased(byAsyncId_, subscription.id, id);
+            break;
+        case EventSubscription::Kind::Handle:
+            router.byHandle_ = Erased(byHandle_, subscription.id, id);
+            break;
+        case EventSubscription::Kind::Room:
+            router.byRoom_ = Erased(byRoom_, subscription.roomSid, id);
+            break;
+    }
+    return router;
+}
+
+void EventRouter::Dispatch(const EventView& event) const {
+    Invoke(broadcast_, event);
+    size_t type = static_cast<size_t>(event.GetType());
+    if (type < kMaxEventTypes) {
+        Invoke(byType_[type], event);
+    }
+    if (event.GetAsyncId() != 0) {
+        if (const SharedList *list = Find(byAsyncId_, event.GetAsyncId())) {
+            Invoke(*list, event);
+        }
+    }
+    if (event.GetHandleId() != 0) {
+        if (const SharedList *list = Find(byHandle_, event.GetHandleId())) {
+            Invoke(*list, event);
+        }
+    }
+    if (event.HasRoomSid()) {
+        if (const SharedList *list = Find(byRoom_, event.GetRoomSid())) {
+            Invoke(*list, event);
+        }
+    }
+}
+
+void EventRouter::Invoke(const SharedList& list, const EventView& event) {
+    if (!list) {
+        return;
+    }
+    for (auto& [id, listener] : *list) {
+        LIVEKIT_TRACE_SCOPE("listener", "listener", "id", id);
+        listener(event);
+    }
+}
+
+template<typename Key>
+const EventRouter::SharedList *EventRouter::Find(const SharedMap<Key>& map, const Key& key) {
+    if (!map) {
+        return nullptr;
+    }
+    auto it = map->find(key);
+    return it != map->end() ? &it->second : nullptr;
+}
+
+}
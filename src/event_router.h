@@ -0,0 +1,74 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_EVENT_ROUTER_H
+#define LIVEKIT_EVENT_ROUTER_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "livekit/event_view.h"
+#include "livekit/ffi_client.h"
+
+namespace livekit
+{
+    // Immutable index of the listeners, by kind of subscription.
+    // FfiClient publishes a new router on every registration change, and
+    // dispatch reads the current one without locking. Lists and the maps
+    // holding them are shared between successive routers, only the list and
+    // map being modified are copied.
+    class EventRouter
+    {
+    public:
+        using ListenerId = FfiClient::ListenerId;
+        using Listener = FfiClient::ViewListener;
+
+        EventRouter WithListener(ListenerId id, const EventSubscription& subscription,
+                                 const Listener& listener) const;
+        // `subscription` is the one `id` was registered with
+        EventRouter WithoutListener(ListenerId id, const EventSubscription& subscription) const;
+
+        // Routes on the header of the event, which is only decoded if a
+        // listener asks for it
+        void Dispatch(const EventView& event) const;
+
+    private:
+        using ListenerList = std::vector<std::pair<ListenerId, Listener>>;
+        using SharedList = std::shared_ptr<const ListenerList>;
+        template<typename Key>
+        using SharedMap = std::shared_ptr<const std::unordered_map<Key, SharedList>>;
+
+        // FFIEvent oneof cases are small field numbers, indexed directly.
+        // Sized from EventTraits, so every Subscribe<T> has its slot.
+        static constexpr size_t kMaxEventTypes = kEventCaseLimit;
+
+        SharedList broadcast_;
+        std::array<SharedList, kMaxEventTypes> byType_{};
+        // Null while empty
+        SharedMap<uint64_t> byAsyncId_;
+        SharedMap<uint64_t> byHandle_;
+        SharedMap<std::string> byRoom_;
+
+        static void Invoke(const SharedList& list, const EventView& event);
+        template<typename Key>
+        static const SharedList *Find(const SharedMap<Key>& map, const Key& key);
+    };
+}
+
+#endif /* LIVEKIT_EVENT_ROUTER_H */
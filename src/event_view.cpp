@@ -0,0 +1,99 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/event_view.h"
+
+#include <iostream>
+
+#include "event_peek.h"
+#include "metrics_recorder.h"
+#include "tracer.h"
+
+namespace livekit
+{
+
+EventView::EventView(const uint8_t *data, size_t len, google::protobuf::Arena *arena)
+    : data_(data), len_(len), arena_(arena) {
+    EventHeader header;
+    valid_ = PeekEventHeader(data, len, header);
+    type_ = header.type;
+    asyncId_ = header.asyncId;
+    handleId_ = header.handleId;
+    roomSid_.assign(header.roomSid.data(), header.roomSid.size());
+}
+
+EventView::EventView(const FFIEvent& event) : valid_(true), type_(event.message_case()), event_(&event) {
+    switch (type_) {
+        case FFIEvent::kRoomEvent:
+            roomSid_ = event.room_event().room_sid();
+            break;
+        case FFIEvent::kVideoStreamEvent:
+            handleId_ = event.video_stream_event().handle().id();
+            break;
+        case FFIEvent::kAudioStreamEvent:
+            handleId_ = event.audio_stream_event().handle().id();
+            break;
+        case FFIEvent::kConnect:
+            asyncId_ = event.connect().async_id().id();
+            break;
+        case FFIEvent::kDisconnect:
+            asyncId_ = event.disconnect().async_id().id();
+            break;
+        case FFIEvent::kDispose:
+            asyncId_ = event.dispose().async_id().id();
+            break;
+        case FFIEvent::kPublishTrack:
+            asyncId_ = event.publish_track().async_id().id();
+            break;
+        default:
+            break;
+    }
+}
+
+const FFIEvent *EventView::TryGet() const {
+    if (event_ != nullptr) {
+        return malformed_ ? nullptr : event_;
+    }
+
+    LIVEKIT_TRACE_SCOPE("event", "DecodeEvent", "bytes", len_);
+    uint64_t start = MetricsRecorder::Enabled() ? MetricsRecorder::Now() : 0;
+    FFIEvent *event;
+    if (arena_ != nullptr) {
+        event = google::protobuf::Arena::CreateMessage<FFIEvent>(arena_);
+    } else {
+        owned_ = std::make_unique<FFIEvent>();
+        event = owned_.get();
+    }
+
+    bool parsed = valid_ && event->ParseFromArray(data_, static_cast<int>(len_));
+    if (!parsed) {
+        std::cerr << "failed to parse FFIEvent, dropping it" << std::endl;
+        event->Clear();
+        malformed_ = true;
+    }
+    if (start != 0) {
+        MetricsRecorder::RecordParse(MetricsRecorder::Now() - start, !parsed);
+    }
+    event_ = event;
+    return parsed ? event_ : nullptr;
+}
+
+const FFIEvent& EventView::Get() const {
+    TryGet();
+    return *event_;
+}
+
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/executor.h"
+
+#include <iostream>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace livekit
+{
+
+namespace
+{
+
+// Tasks a strand runs before handing its thread back to the executor, so a
+// busy strand doesn't starve the others sharing it
+constexpr size_t kStrandBatch = 64;
+
+}
+
+struct Strand::State : std::enable_shared_from_this<Strand::State> {
+    Executor executor;
+    std::mutex lock;
+    std::deque<std::function<void()>> tasks;
+    // Whether a drain is scheduled or running on the executor
+    bool scheduled = false;
+
+    void Drain() {
+        for (size_t i = 0; i < kStrandBatch; ++i) {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> guard(lock);
+                if (tasks.empty()) {
+                    scheduled = false;
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            try {
+                task();
+            } catch (const std::exception& e) {
+                std::cerr << "strand task threw: " << e.what() << std::endl;
+            }
+        }
+
+        std::unique_lock<std::mutex> guard(lock);
+        if (tasks.empty()) {
+            scheduled = false;
+            return;
+        }
+        guard.unlock();
+        Schedule();
+    }
+
+    void Schedule() {
+        executor([self = shared_from_this()]() { self->Drain(); });
+    }
+};
+
+Strand::Strand(Executor executor) : state_(std::make_shared<State>()) {
+    if (!executor) {
+        throw std::invalid_argument("a strand needs an executor");
+    }
+    state_->executor = std::move(executor);
+}
+
+void Strand::Post(std::function<void()> task) const {
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        state_->tasks.push_back(std::move(task));
+        if (state_->scheduled) {
+            return;
+        }
+        state_->scheduled = true;
+    }
+    state_->Schedule();
+}
+
+Executor Strand::AsExecutor() const {
+    return [strand = *this](std::function<void()> task) { strand.Post(std::move(task)); };
+}
+
+bool ApplyThreadAffinity(const ThreadAffinity& affinity) {
+#if defined(__linux__)
+    bool applied = true;
+    pthread_t self = pthread_self();
+    if (!affinity.cpus.empty()) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : affinity.cpus) {
+            CPU_SET(cpu, &cpus);
+        }
+        applied &= pthread_setaffinity_np(self, sizeof(cpus), &cpus) == 0;
+    }
+    if (affinity.realtimePriority > 0) {
+        sched_param param{};
+        param.sched_priority = affinity.realtimePriority;
+        applied &= pthread_setschedparam(self, SCHED_FIFO, &param) == 0;
+    }
+    if (!affinity.name.empty()) {
+        applied &= pthread_setname_np(self, affinity.name.substr(0, 15).c_str()) == 0;
+    }
+    return applied;
+#else
+    return affinity.cpus.empty() && affinity.realtimePriority == 0 && affinity.name.empty();
+#endif
+}
+
+ThreadPoolExecutor::ThreadPoolExecutor(size_t threads, const ThreadAffinity& affinity) {
+    if (threads == 0) {
+        throw std::invalid_argument("a thread pool needs threads");
+    }
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, affinity]() { Run(affinity); });
+    }
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor() {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stopped_ = true;
+    }
+    wakeup_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void ThreadPoolExecutor::Post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        tasks_.push_back(std::move(task));
+    }
+    wakeup_.notify_one();
+}
+
+Executor ThreadPoolExecutor::GetExecutor() {
+    return [this](std::function<void()> task) { Post(std::move(task)); };
+}
+
+void ThreadPoolExecutor::Run(const ThreadAffinity& affinity) {
+    if (!ApplyThreadAffinity(affinity)) {
+        std::cerr << "failed to apply the thread affinity of " << affinity.name << std::endl;
+    }
+
+    std::unique_lock<std::mutex> guard(lock_);
+    while (true) {
+        wakeup_.wait(guard, [this]() { return stopped_ || !tasks_.empty(); });
+        if (tasks_.empty()) {
+            return;
+        }
+        std::function<void()> task = std::move(tasks_.front());
+        tasks_.pop_front();
+        guard.unlock();
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            std::cerr << "executor task threw: " << e.what() << std::endl;
+        }
+        guard.lock();
+    }
+}
+
+}
@@ -14,16 +14,170 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include <google/protobuf/arena.h>
 
 #include "livekit/ffi_client.h"
+#include "event_peek.h"
+#include "event_queue.h"
+#include "event_router.h"
+#include "handle_releaser.h"
+#include "metrics_recorder.h"
+#include "tracer.h"
 #include "ffi.pb.h"
 #include "livekit_ffi.h"
 
 namespace livekit
 {
 
-FfiClient::FfiClient() {
+namespace
+{
+
+uint64_t GetAsyncId(const FFIResponse &response) {
+    switch (response.message_case()) {
+        case FFIResponse::kConnect:
+            return response.connect().async_id().id();
+        case FFIResponse::kDisconnect:
+            return response.disconnect().async_id().id();
+        case FFIResponse::kDispose:
+            if (response.dispose().has_async_id()) {
+                return response.dispose().async_id().id();
+            }
+            break;
+        case FFIResponse::kPublishTrack:
+            return response.publish_track().async_id().id();
+        default:
+            break;
+    }
+    throw std::runtime_error("the response doesn't carry an FFIAsyncId");
+}
+
+// Releases the handles an event hands over to its receiver, for events
+// dropped before anyone took them. Returns false if it owned none.
+bool ReleaseOwnedHandles(const FFIEvent& event) {
+    std::vector<uint64_t> handles;
+    switch (event.message_case()) {
+        case FFIEvent::kVideoStreamEvent:
+            if (event.video_stream_event().has_frame_received()) {
+                handles.push_back(event.video_stream_event().frame_received().buffer().handle().id());
+            }
+            break;
+        case FFIEvent::kAudioStreamEvent:
+            if (event.audio_stream_event().has_frame_received()) {
+                handles.push_back(event.audio_stream_event().frame_received().frame().handle().id());
+            }
+            break;
+        case FFIEvent::kRoomEvent: {
+            const RoomEvent& roomEvent = event.room_event();
+            if (roomEvent.has_data_received()) {
+                handles.push_back(roomEvent.data_received().handle().id());
+            } else if (roomEvent.has_track_subscribed() && roomEvent.track_subscribed().track().has_opt_handle()) {
+                handles.push_back(roomEvent.track_subscribed().track().opt_handle().id());
+            }
+            break;
+        }
+        case FFIEvent::kConnect:
+            if (!event.connect().has_error()) {
+                handles.push_back(event.connect().room().handle().id());
+            }
+            break;
+        default:
+            break;
+    }
+
+    bool owned = false;
+    for (uint64_t handle : handles) {
+        if (handle != INVALID_HANDLE) {
+            FfiHandle orphan(handle);
+            owned = true;
+        }
+    }
+    return owned;
+}
+
+// Async sends in progress on this thread, see FfiClient::CompleteAsync
+thread_local int asyncSendDepth = 0;
+
+struct AsyncSendScope {
+    AsyncSendScope() { asyncSendDepth++; }
+    ~AsyncSendScope() { asyncSendDepth--; }
+};
+
+// Not reached through FfiClient::getInstance(), handles are dropped while the
+// instance is being constructed
+std::atomic<HandleReleaser*> deferredReleaser{nullptr};
+
+// Arena used to decode FFIEvents on a given thread. It is backed by a block we
+// own, so Reset() hands the memory back for the next event instead of running
+// the destructor tree of the decoded message. If an event spilled outside of
+// the block, the block is grown so the next burst fits in it.
+class EventArena {
+public:
+    static constexpr size_t kMinBlockSize = 64 * 1024;
+    static constexpr size_t kMaxBlockSize = 4 * 1024 * 1024;
+
+    EventArena() { Allocate(kMinBlockSize); }
+
+    google::protobuf::Arena *Get() { return &*arena_; }
+
+    void Reset() {
+        size_t used = arena_->SpaceAllocated();
+        if (used > block_.size() && block_.size() < kMaxBlockSize) {
+            arena_.reset();
+            Allocate(std::min(std::max(used, block_.size() * 2), kMaxBlockSize));
+        } else {
+            arena_->Reset();
+        }
+    }
+
+private:
+    std::vector<char> block_;
+    std::optional<google::protobuf::Arena> arena_;
+
+    void Allocate(size_t size) {
+        block_.resize(size);
+
+        google::protobuf::ArenaOptions options;
+        options.initial_block = block_.data();
+        options.initial_block_size = block_.size();
+        arena_.emplace(options);
+    }
+};
+
+// Receives the events popped by PollEvents and WaitEvents. The thread's
+// buffer is reused, except by polls made from a listener: events are decoded
+// lazily, the outer one may still be read from it.
+class PollBuffer {
+public:
+    PollBuffer() : nested_(Busy()) { Busy() = true; }
+    ~PollBuffer() { Busy() = nested_; }
+
+    std::vector<uint8_t>& Get() { return nested_ ? local_ : Shared(); }
+
+private:
+    bool nested_;
+    std::vector<uint8_t> local_;
+
+    static bool& Busy() {
+        thread_local bool busy = false;
+        return busy;
+    }
+    static std::vector<uint8_t>& Shared() {
+        thread_local std::vector<uint8_t> buf;
+        return buf;
+    }
+};
+
+}
+
+FfiClient::FfiClient() : router_(std::make_shared<const EventRouter>()) {
     InitializeRequest *initRequest = new InitializeRequest;
     initRequest->set_event_callback_ptr(reinterpret_cast<uint64_t>(&LivekitFfiCallback));
 
@@ -32,57 +186,465 @@ FfiClient::FfiClient() {
     SendRequest(request);
 }
 
+FfiClient::~FfiClient() {
+    // The dispatchers may be dropping handles through the releaser, stop
+    // them before it goes away
+    for (std::unique_ptr<EventQueue>& queue : eventQueues_) {
+        queue->Close();
+    }
+    for (std::thread& dispatcher : dispatchers_) {
+        dispatcher.join();
+    }
+
+    // Handles dropped from here on are released synchronously
+    deferredReleaser.store(nullptr, std::memory_order_release);
+    releaser_.reset();
+}
+
 FfiClient::ListenerId FfiClient::AddListener(const FfiClient::Listener& listener) {
+    return AddListener(EventSubscription::All(), listener);
+}
+
+FfiClient::ListenerId FfiClient::AddListener(const EventSubscription& subscription,
+                                             const FfiClient::Listener& listener) {
+    return AddViewListener(subscription, [listener](const EventView& event) {
+        if (const FFIEvent *decoded = event.TryGet()) {
+            listener(*decoded);
+        }
+    });
+}
+
+FfiClient::ListenerId FfiClient::AddViewListener(const EventSubscription& subscription,
+                                                 const FfiClient::ViewListener& listener) {
     std::lock_guard<std::mutex> guard(lock_);
     FfiClient::ListenerId id = nextListenerId++;
-    listeners_[id] = listener;
+
+    std::shared_ptr<const EventRouter> router = std::atomic_load(&router_);
+    std::atomic_store(&router_, std::make_shared<const EventRouter>(router->WithListener(id, subscription, listener)));
+    subscriptions_.emplace(id, subscription);
     return id;
 }
 
 void FfiClient::RemoveListener(ListenerId id) {
     std::lock_guard<std::mutex> guard(lock_);
-    listeners_.erase(id);
+    auto subscription = subscriptions_.find(id);
+    if (subscription == subscriptions_.end()) {
+        return;
+    }
+
+    std::shared_ptr<const EventRouter> router = std::atomic_load(&router_);
+    std::atomic_store(&router_, std::make_shared<const EventRouter>(router->WithoutListener(id, subscription->second)));
+    subscriptions_.erase(subscription);
 }
 
 FFIResponse FfiClient::SendRequest(const FFIRequest &request) const {
-    size_t len = request.ByteSizeLong();
-    uint8_t *buf = new uint8_t[len];
-    assert(request.SerializeToArray(buf, len));
+    FFIResponse response;
+    SendRequest(request, response);
+    return response;
+}
 
-    const uint8_t **res_ptr = new const uint8_t*;
-    size_t *res_len = new size_t;
-    
-    FfiHandleId handle = livekit_ffi_request(buf, len, res_ptr, res_len);
+void FfiClient::SendRequest(const FFIRequest &request, FFIResponse &response) const {
+    // Grows to the largest request sent from this thread, then stays put
+    thread_local std::vector<uint8_t> buf;
 
-    delete[] buf;
+    LIVEKIT_TRACE_SCOPE("request", Tracer::RequestName(request.message_case()));
+    uint64_t start = MetricsRecorder::Enabled() ? MetricsRecorder::Now() : 0;
+    size_t len = request.ByteSizeLong();
+    if (len > static_cast<size_t>(INT_MAX)) {
+        throw std::runtime_error("failed to serialize FFIRequest, too large");
+    }
+    if (buf.size() < len) {
+        buf.resize(len);
+    }
+    // Writes exactly the cached size unless the request changed meanwhile
+    if (request.SerializeWithCachedSizesToArray(buf.data()) != buf.data() + len) {
+        throw std::runtime_error("failed to serialize FFIRequest");
+    }
+
+    const uint8_t *res_ptr = nullptr;
+    size_t res_len = 0;
+    FfiHandleId handle = livekit_ffi_request(buf.data(), len, &res_ptr, &res_len);
     if (handle == INVALID_HANDLE) {
-        delete res_ptr;
-        delete res_len;
+        if (start != 0) {
+            MetricsRecorder::RecordRequest(request.message_case(), MetricsRecorder::Now() - start, true);
+        }
         throw std::runtime_error("failed to send request, received an invalid handle");
     }
+
+    // The response bytes are owned by the handle and released once parsed
     FfiHandle _handle(handle);
+    bool parsed = response.ParseFromArray(res_ptr, res_len);
+    if (start != 0) {
+        MetricsRecorder::RecordRequest(request.message_case(), MetricsRecorder::Now() - start, !parsed);
+    }
+    if (!parsed) {
+        throw std::runtime_error("failed to parse FFIResponse");
+    }
+}
 
-    FFIResponse response;
-    assert(response.ParseFromArray(*res_ptr, *res_len));
-    delete res_ptr;
-    delete res_len;
+void FfiClient::EnableEventQueue(const EventQueueOptions& options) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (!eventQueues_.empty()) {
+        throw std::runtime_error("event queue already enabled");
+    }
+    if (options.capacity == 0) {
+        throw std::invalid_argument("event queue needs a capacity");
+    }
 
-    return response;
+    size_t queueCount = options.pinned ? std::max<size_t>(options.dispatcherThreads, 1) : 1;
+    for (size_t i = 0; i < queueCount; ++i) {
+        eventQueues_.push_back(std::make_unique<EventQueue>(options.capacity));
+    }
+
+    polled_ = options.dispatcherThreads == 0;
+    for (size_t i = 0; i < options.dispatcherThreads; ++i) {
+        dispatchers_.emplace_back([this, i, queue = eventQueues_[i % queueCount].get(),
+                                   onStart = options.onDispatcherStart]() {
+            if (onStart) {
+                onStart(i);
+            }
+            std::vector<uint8_t> buf;
+            while (queue->WaitPop(buf)) {
+                DispatchEvent(buf.data(), buf.size());
+            }
+        });
+    }
+    queueCount_.store(queueCount, std::memory_order_release);
 }
 
-void FfiClient::PushEvent(const FFIEvent &event) const {
-    // Dispatch the events to the internal listeners
+void FfiClient::SetEventExecutor(EventClass eventClass, Executor executor) {
     std::lock_guard<std::mutex> guard(lock_);
-    for (auto& [_, listener] : listeners_) {
-        listener(event);
+    std::shared_ptr<const Executor> shared;
+    if (executor) {
+        shared = std::make_shared<const Executor>(std::move(executor));
     }
+    std::atomic_store(&eventExecutors_[static_cast<size_t>(eventClass)], std::move(shared));
+
+    bool any = false;
+    for (const std::shared_ptr<const Executor>& set : eventExecutors_) {
+        any |= std::atomic_load(&set) != nullptr;
+    }
+    hasEventExecutors_.store(any, std::memory_order_release);
 }
 
-void LivekitFfiCallback(const uint8_t *buf, size_t len) {
+void FfiClient::EnableDeferredHandleRelease(const HandleReleaseOptions& options) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (releaser_) {
+        throw std::runtime_error("deferred handle release already enabled");
+    }
+    if (options.batchSize == 0) {
+        throw std::invalid_argument("deferred handle release needs a batch size");
+    }
+
+    releaser_ = std::make_unique<HandleReleaser>(options);
+    deferredReleaser.store(releaser_.get(), std::memory_order_release);
+}
+
+void FfiClient::FlushHandleReleases() {
+    if (HandleReleaser *releaser = deferredReleaser.load(std::memory_order_acquire)) {
+        releaser->Flush();
+    }
+}
+
+void FfiClient::EnableMetrics(bool enabled) {
+    MetricsRecorder::SetEnabled(enabled);
+}
+
+bool FfiClient::StartTracing(size_t maxEventsPerThread) {
+    return Tracer::Start(maxEventsPerThread);
+}
+
+bool FfiClient::StopTracing(const std::string& path) {
+    return Tracer::Stop(path);
+}
+
+FfiMetrics FfiClient::GetMetrics() const {
+    FfiMetrics metrics;
+    metrics.enabled = MetricsRecorder::Enabled();
+    MetricsRecorder::Collect(metrics);
+
+    size_t queueCount = queueCount_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < queueCount; ++i) {
+        const EventQueue& queue = *eventQueues_[i];
+        metrics.queueDepths.push_back(queue.Depth());
+        metrics.queueCapacity += queue.Capacity();
+        metrics.eventsEnqueued += queue.Enqueued();
+        metrics.eventsDropped += queue.Dropped();
+    }
+    metrics.pendingAsyncRequests = PendingAsyncRequests();
+    return metrics;
+}
+
+EventQueueStats FfiClient::GetEventQueueStats() const {
+    EventQueueStats stats{};
+    size_t queueCount = queueCount_.load(std::memory_order_acquire);
+    for (size_t i = 0; i < queueCount; ++i) {
+        const EventQueue& queue = *eventQueues_[i];
+        stats.depth += queue.Depth();
+        stats.capacity += queue.Capacity();
+        stats.enqueued += queue.Enqueued();
+        stats.dropped += queue.Dropped();
+    }
+    stats.droppedWithHandles = droppedWithHandles_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+size_t FfiClient::GetRoomDispatcher(const std::string& roomSid) const {
+    size_t queueCount = queueCount_.load(std::memory_order_acquire);
+    return queueCount > 1 ? RoomAffinity(roomSid) % queueCount : 0;
+}
+
+EventQueue& FfiClient::GetPolledQueue() const {
+    if (queueCount_.load(std::memory_order_acquire) == 0 || !polled_) {
+        throw std::runtime_error("the event queue isn't enabled without dispatcher threads");
+    }
+    return *eventQueues_.front();
+}
+
+void FfiClient::QueueEvent(const uint8_t *buf, size_t len, size_t queueCount) {
+    size_t index = 0;
+    if (queueCount > 1) {
+        uint64_t affinity;
+        if (PeekEventAffinity(buf, len, affinity)) {
+            index = affinity % queueCount;
+        } else {
+            index = nextQueue_.fetch_add(1, std::memory_order_relaxed) % queueCount;
+        }
+    }
+    if (eventQueues_[index]->TryPush(buf, len)) {
+        return;
+    }
+
+    // Nobody will see the event, release what it hands over
     FFIEvent event;
-    assert(event.ParseFromArray(buf, len));
+    if (event.ParseFromArray(buf, static_cast<int>(len)) && ReleaseOwnedHandles(event)) {
+        droppedWithHandles_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+size_t FfiClient::PollEvents(size_t maxEvents) {
+    EventQueue& queue = GetPolledQueue();
+
+    PollBuffer buf;
+    size_t count = 0;
+    while (count < maxEvents && queue.TryPop(buf.Get())) {
+        DispatchEvent(buf.Get().data(), buf.Get().size());
+        count++;
+    }
+    return count;
+}
+
+size_t FfiClient::WaitEvents(std::chrono::milliseconds timeout, size_t maxEvents) {
+    EventQueue& queue = GetPolledQueue();
+    if (maxEvents == 0) {
+        return 0;
+    }
+
+    auto deadline = timeout == std::chrono::milliseconds::max()
+        ? std::chrono::steady_clock::time_point::max()
+        : std::chrono::steady_clock::now() + timeout;
+
+    {
+        PollBuffer buf;
+        if (!queue.WaitPopUntil(buf.Get(), deadline)) {
+            return 0;
+        }
+        DispatchEvent(buf.Get().data(), buf.Get().size());
+    }
+    return 1 + PollEvents(maxEvents - 1);
+}
+
+void FfiClient::DispatchEvent(const uint8_t *buf, size_t len) {
+    if (hasEventExecutors_.load(std::memory_order_acquire) && SubmitEvent(buf, len)) {
+        return;
+    }
+    DispatchEventNow(buf, len);
+}
+
+// Returns false if the event's class has no executor
+bool FfiClient::SubmitEvent(const uint8_t *buf, size_t len) {
+    EventHeader header;
+    if (!PeekEventHeader(buf, len, header)) {
+        return false;
+    }
+
+    EventClass eventClass = EventClass::Control;
+    if (header.type == FFIEvent::kAudioStreamEvent) {
+        eventClass = EventClass::Audio;
+    } else if (header.type == FFIEvent::kVideoStreamEvent) {
+        eventClass = EventClass::Video;
+    }
+    std::shared_ptr<const Executor> executor = std::atomic_load(&eventExecutors_[static_cast<size_t>(eventClass)]);
+    if (!executor) {
+        return false;
+    }
+
+    (*executor)([this, bytes = std::vector<uint8_t>(buf, buf + len)]() {
+        DispatchEventNow(bytes.data(), bytes.size());
+    });
+    return true;
+}
+
+void FfiClient::DispatchEventNow(const uint8_t *buf, size_t len) {
+    thread_local EventArena arena;
+    // Listeners may cause events to be dispatched on the same thread (e.g. by
+    // pumping events), only recycle the arena once the outermost one is done
+    thread_local int depth = 0;
+
+    struct ArenaScope {
+        ArenaScope() { depth++; }
+        ~ArenaScope() {
+            if (--depth == 0) {
+                arena.Reset();
+            }
+        }
+    } scope;
+
+    uint64_t start = MetricsRecorder::Enabled() ? MetricsRecorder::Now() : 0;
+    EventView event(buf, len, arena.Get());
+    if (!event.IsValid()) {
+        if (start != 0) {
+            MetricsRecorder::RecordParse(MetricsRecorder::Now() - start, true);
+        }
+        // Never throw back into the Rust runtime
+        std::cerr << "failed to parse FFIEvent, dropping it" << std::endl;
+        return;
+    }
+
+    PushEvent(event);
+    if (start != 0) {
+        MetricsRecorder::RecordListeners(MetricsRecorder::Now() - start);
+    }
+}
+
+void FfiClient::PushEvent(const EventView &event) {
+    LIVEKIT_TRACE_SCOPE("event", Tracer::EventName(event.GetType()));
+    if (event.GetAsyncId() != 0 && asyncOutstanding_.load(std::memory_order_acquire) != 0) {
+        CompleteAsync(event.GetAsyncId(), event);
+    }
+
+    // Dispatch the events to the internal listeners. The snapshot keeps the
+    // listeners alive even if they are removed while running.
+    std::shared_ptr<const EventRouter> router = std::atomic_load(&router_);
+    router->Dispatch(event);
+}
+
+void FfiClient::SendAsyncRequest(const FFIRequest &request, AsyncCallback callback) {
+    uint64_t send;
+    {
+        std::lock_guard<std::mutex> guard(asyncLock_);
+        send = nextAsyncSend_++;
+        asyncSends_.insert(send);
+        asyncOutstanding_.fetch_add(1, std::memory_order_release);
+    }
+
+    uint64_t asyncId;
+    try {
+        AsyncSendScope scope;
+        FFIResponse response;
+        SendRequest(request, response);
+        asyncId = GetAsyncId(response);
+        LIVEKIT_TRACE_ASYNC_BEGIN("async", Tracer::RequestName(request.message_case()), asyncId);
+    } catch (...) {
+        std::lock_guard<std::mutex> guard(asyncLock_);
+        FinishAsyncSend(send);
+        throw;
+    }
+
+    std::unique_lock<std::mutex> guard(asyncLock_);
+    auto early = earlyAsync_.find(asyncId);
+    if (early == earlyAsync_.end()) {
+        pendingAsync_.emplace(asyncId, std::move(callback));
+        asyncOutstanding_.fetch_add(1, std::memory_order_release);
+        FinishAsyncSend(send);
+        return;
+    }
+
+    // The callback was emitted from within the request, on this thread
+    FFIEvent event = std::move(early->second);
+    earlyAsync_.erase(early);
+    FinishAsyncSend(send);
+    guard.unlock();
+
+    LIVEKIT_TRACE_ASYNC_END("async", Tracer::EventName(event.message_case()), asyncId);
+    LIVEKIT_TRACE_SCOPE("listener", "AsyncCallback", "async_id", asyncId);
+    callback(event);
+}
+
+std::future<FFIEvent> FfiClient::SendAsyncRequest(const FFIRequest &request) {
+    auto promise = std::make_shared<std::promise<FFIEvent>>();
+    std::future<FFIEvent> future = promise->get_future();
+    SendAsyncRequest(request, [promise](const FFIEvent& event) {
+        promise->set_value(event);
+    });
+    return future;
+}
+
+size_t FfiClient::PendingAsyncRequests() const {
+    return asyncOutstanding_.load(std::memory_order_relaxed);
+}
+
+// Called with asyncLock_ held once a send is over
+void FfiClient::FinishAsyncSend(uint64_t send) {
+    asyncSends_.erase(send);
+    asyncOutstanding_.fetch_sub(1, std::memory_order_release);
+    asyncRegistered_.notify_all();
+
+    // Whatever is left belongs to requests nobody waits on
+    if (asyncSends_.empty()) {
+        earlyAsync_.clear();
+    }
+}
+
+void FfiClient::CompleteAsync(uint64_t asyncId, const EventView &event) {
+    std::unique_lock<std::mutex> guard(asyncLock_);
+    auto registered = [&]() { return pendingAsync_.count(asyncId) != 0; };
+    if (!registered() && !asyncSends_.empty()) {
+        // A thread can't wait for its own send, the sender completes it
+        if (asyncSendDepth > 0) {
+            if (const FFIEvent *decoded = event.TryGet()) {
+                earlyAsync_.emplace(asyncId, *decoded);
+            }
+            return;
+        }
+        // Only waits for the sends already in flight, which are past their
+        // FFI call or about to be: later sends can't own this callback
+        uint64_t horizon = nextAsyncSend_;
+        asyncRegistered_.wait(guard, [&]() {
+            return registered() || asyncSends_.empty() || *asyncSends_.begin() >= horizon;
+        });
+    }
+
+    auto pending = pendingAsync_.find(asyncId);
+    if (pending == pendingAsync_.end()) {
+        return;
+    }
+    // A malformed callback leaves the request pending rather than completing
+    // it with an empty event
+    const FFIEvent *decoded = event.TryGet();
+    if (decoded == nullptr) {
+        return;
+    }
+
+    AsyncCallback callback = std::move(pending->second);
+    pendingAsync_.erase(pending);
+    asyncOutstanding_.fetch_sub(1, std::memory_order_release);
+    guard.unlock();
 
-    FfiClient::getInstance().PushEvent(event);
+    LIVEKIT_TRACE_ASYNC_END("async", Tracer::EventName(event.GetType()), asyncId);
+    LIVEKIT_TRACE_SCOPE("listener", "AsyncCallback", "async_id", asyncId);
+    callback(*decoded);
+}
+
+void LivekitFfiCallback(const uint8_t *buf, size_t len) {
+    LIVEKIT_TRACE_SCOPE("event", "LivekitFfiCallback", "bytes", len);
+    FfiClient& client = FfiClient::getInstance();
+    if (size_t queueCount = client.queueCount_.load(std::memory_order_acquire)) {
+        client.QueueEvent(buf, len, queueCount);
+        return;
+    }
+
+    client.DispatchEvent(buf, len);
 }
 
 // FfiHandle
@@ -90,8 +652,35 @@ void LivekitFfiCallback(const uint8_t *buf, size_t len) {
 FfiHandle::FfiHandle(uintptr_t id) : handle(id) {}
 
 FfiHandle::~FfiHandle() {
-    if (handle != INVALID_HANDLE) {
-        assert(livekit_ffi_drop_handle(handle));
+    Reset();
+}
+
+FfiHandle::FfiHandle(FfiHandle&& other) noexcept : handle(other.Release()) {}
+
+FfiHandle& FfiHandle::operator=(FfiHandle&& other) noexcept {
+    if (this != &other) {
+        Reset(other.Release());
+    }
+    return *this;
+}
+
+uintptr_t FfiHandle::Release() {
+    uintptr_t id = handle;
+    handle = INVALID_HANDLE;
+    return id;
+}
+
+void FfiHandle::Reset(uintptr_t id) {
+    uintptr_t previous = handle;
+    handle = id;
+    if (previous == INVALID_HANDLE) {
+        return;
+    }
+
+    if (HandleReleaser *releaser = deferredReleaser.load(std::memory_order_acquire)) {
+        releaser->Defer(previous);
+    } else {
+        HandleReleaser::Release(previous);
     }
 }
 
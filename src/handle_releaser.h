@@ -0,0 +1,124 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_HANDLE_RELEASER_H
+#define LIVEKIT_HANDLE_RELEASER_H
+
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "livekit/ffi_client.h"
+#include "livekit_ffi.h"
+
+namespace livekit
+{
+    // Collects the handles dropped by FfiHandle and releases them from its
+    // own thread, once `batchSize` of them are pending or after `maxDelay`.
+    // Deferring only costs the dropping thread a push under a short lock.
+    class HandleReleaser
+    {
+    public:
+        explicit HandleReleaser(const HandleReleaseOptions& options) : options_(options) {
+            pending_.reserve(options_.batchSize);
+            thread_ = std::thread([this]() { Run(); });
+        }
+
+        ~HandleReleaser() {
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                stopped_ = true;
+            }
+            wakeup_.notify_one();
+            thread_.join();
+            Release(pending_);
+        }
+
+        HandleReleaser(const HandleReleaser&) = delete;
+        HandleReleaser& operator=(const HandleReleaser&) = delete;
+
+        void Defer(uintptr_t handle) {
+            bool full;
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                pending_.push_back(handle);
+                full = pending_.size() == options_.batchSize;
+            }
+            if (full) {
+                wakeup_.notify_one();
+            }
+        }
+
+        // Releases what is pending on the calling thread
+        void Flush() {
+            std::vector<uintptr_t> batch;
+            {
+                std::lock_guard<std::mutex> guard(lock_);
+                batch.swap(pending_);
+            }
+            Release(batch);
+        }
+
+        static void Release(uintptr_t handle) {
+            bool released = livekit_ffi_drop_handle(handle);
+            assert(released);
+            (void)released;
+        }
+
+    private:
+        HandleReleaseOptions options_;
+        std::mutex lock_;
+        std::condition_variable wakeup_;
+        std::vector<uintptr_t> pending_;
+        bool stopped_{false};
+        std::thread thread_;
+
+        static void Release(std::vector<uintptr_t>& batch) {
+            for (uintptr_t handle : batch) {
+                Release(handle);
+            }
+            batch.clear();
+        }
+
+        void Run() {
+            // Two batches swapped back and forth, so steady state doesn't allocate
+            std::vector<uintptr_t> batch;
+            batch.reserve(options_.batchSize);
+
+            std::unique_lock<std::mutex> guard(lock_);
+            while (true) {
+                wakeup_.wait_for(guard, options_.maxDelay, [this]() {
+                    return stopped_ || pending_.size() >= options_.batchSize;
+                });
+                bool stopped = stopped_;
+                batch.swap(pending_);
+                guard.unlock();
+
+                Release(batch);
+                if (stopped) {
+                    return;
+                }
+                guard.lock();
+            }
+        }
+    };
+}
+
+#endif /* LIVEKIT_HANDLE_RELEASER_H */
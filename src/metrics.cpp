@@ -0,0 +1,101 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/metrics.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace livekit
+{
+
+namespace
+{
+
+constexpr size_t kSubBucketBits = 3;
+static_assert(LatencyHistogram::kSubBuckets == 1 << kSubBucketBits, "sub-buckets must match their bits");
+
+unsigned HighestBit(uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+}
+
+// Values below kSubBuckets get a bucket each. Above, the power of two of a
+// value picks a group of kSubBuckets buckets and the bits right below its
+// highest one pick the bucket within the group.
+size_t LatencyHistogram::BucketIndex(uint64_t valueNs) {
+    if (valueNs < kSubBuckets) {
+        return static_cast<size_t>(valueNs);
+    }
+    size_t group = HighestBit(valueNs) - kSubBucketBits + 1;
+    size_t index = group * kSubBuckets + ((valueNs >> (group - 1)) & (kSubBuckets - 1));
+    return std::min(index, kBucketCount - 1);
+}
+
+uint64_t LatencyHistogram::BucketLowerBound(size_t index) {
+    size_t group = index / kSubBuckets;
+    uint64_t sub = index % kSubBuckets;
+    if (group == 0) {
+        return sub;
+    }
+    return (kSubBuckets + sub) << (group - 1);
+}
+
+uint64_t LatencyHistogram::PercentileNs(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(clamped / 100.0 * count)), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return i + 1 < kBucketCount ? std::min(BucketLowerBound(i + 1) - 1, maxNs) : maxNs;
+        }
+    }
+    return maxNs;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+    if (other.count == 0) {
+        return;
+    }
+
+    minNs = count == 0 ? other.minNs : std::min(minNs, other.minNs);
+    maxNs = std::max(maxNs, other.maxNs);
+    count += other.count;
+    sumNs += other.sumNs;
+
+    counts.resize(std::max(counts.size(), other.counts.size()));
+    for (size_t i = 0; i < other.counts.size(); ++i) {
+        counts[i] += other.counts[i];
+    }
+}
+
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "metrics_recorder.h"
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+// FFIRequest oneof cases are small field numbers, anything past this is
+// recorded as MESSAGE_NOT_SET
+constexpr size_t kMaxRequestTypes = 64;
+
+// Only the owning thread writes a block, so a relaxed load and store is
+// enough and avoids the locked read-modify-write
+void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+class ThreadHistogram {
+public:
+    void Record(uint64_t value) {
+        Add(counts_[LatencyHistogram::BucketIndex(value)], 1);
+        Add(count_, 1);
+        Add(sum_, value);
+        if (value < min_.load(std::memory_order_relaxed)) {
+            min_.store(value, std::memory_order_relaxed);
+        }
+        if (value > max_.load(std::memory_order_relaxed)) {
+            max_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    void AddTo(LatencyHistogram& histogram) const {
+        LatencyHistogram local;
+        local.count = count_.load(std::memory_order_relaxed);
+        if (local.count == 0) {
+            return;
+        }
+        local.sumNs = sum_.load(std::memory_order_relaxed);
+        local.minNs = min_.load(std::memory_order_relaxed);
+        local.maxNs = max_.load(std::memory_order_relaxed);
+        local.counts.resize(LatencyHistogram::kBucketCount);
+        for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i) {
+            local.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        }
+        histogram.Merge(local);
+    }
+
+private:
+    std::atomic<uint64_t> counts_[LatencyHistogram::kBucketCount]{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> min_{UINT64_MAX};
+    std::atomic<uint64_t> max_{0};
+};
+
+struct ThreadBlock {
+    ThreadHistogram parse;
+    ThreadHistogram listeners;
+    std::atomic<uint64_t> parseFailures{0};
+
+    // Allocated on the first request of each type, most threads only ever
+    // send a few of them
+    std::array<std::atomic<ThreadHistogram*>, kMaxRequestTypes> requests{};
+    std::array<std::atomic<uint64_t>, kMaxRequestTypes> requestFailures{};
+
+    bool inUse = true;  // under Registry::lock
+
+    ~ThreadBlock() {
+        for (std::atomic<ThreadHistogram*>& histogram : requests) {
+            delete histogram.load(std::memory_order_relaxed);
+        }
+    }
+
+    ThreadHistogram& Request(size_t type) {
+        ThreadHistogram *histogram = requests[type].load(std::memory_order_relaxed);
+        if (histogram == nullptr) {
+            histogram = new ThreadHistogram();
+            requests[type].store(histogram, std::memory_order_release);
+        }
+        return *histogram;
+    }
+};
+
+struct Registry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadBlock>> blocks;
+};
+
+// Leaked: threads may still record while static objects are destroyed
+Registry& GetRegistry() {
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+ThreadBlock *AcquireBlock() {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    for (std::unique_ptr<ThreadBlock>& block : registry.blocks) {
+        if (!block->inUse) {
+            block->inUse = true;
+            return block.get();
+        }
+    }
+    registry.blocks.push_back(std::make_unique<ThreadBlock>());
+    return registry.blocks.back().get();
+}
+
+// A block keeps its values once its thread exits, the next thread to
+// record continues from them
+struct BlockLease {
+    ThreadBlock *block = nullptr;
+
+    ~BlockLease() {
+        if (block != nullptr) {
+            std::lock_guard<std::mutex> guard(GetRegistry().lock);
+            block->inUse = false;
+        }
+    }
+};
+
+ThreadBlock& LocalBlock() {
+    thread_local BlockLease lease;
+    if (lease.block == nullptr) {
+        lease.block = AcquireBlock();
+    }
+    return *lease.block;
+}
+
+}
+
+std::atomic<bool> MetricsRecorder::enabled_{false};
+
+void MetricsRecorder::RecordRequest(int type, uint64_t elapsedNs, bool failed) {
+    size_t index = type > 0 && static_cast<size_t>(type) < kMaxRequestTypes ? static_cast<size_t>(type) : 0;
+    ThreadBlock& block = LocalBlock();
+    block.Request(index).Record(elapsedNs);
+    if (failed) {
+        Add(block.requestFailures[index], 1);
+    }
+}
+
+void MetricsRecorder::RecordParse(uint64_t elapsedNs, bool failed) {
+    ThreadBlock& block = LocalBlock();
+    block.parse.Record(elapsedNs);
+    if (failed) {
+        Add(block.parseFailures, 1);
+    }
+}
+
+void MetricsRecorder::RecordListeners(uint64_t elapsedNs) {
+    LocalBlock().listeners.Record(elapsedNs);
+}
+
+void MetricsRecorder::Collect(FfiMetrics& metrics) {
+    std::vector<RequestMetrics> requests(kMaxRequestTypes);
+    {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        for (const std::unique_ptr<ThreadBlock>& block : registry.blocks) {
+            block->parse.AddTo(metrics.eventParse);
+            block->listeners.AddTo(metrics.listeners);
+            metrics.parseFailures += block->parseFailures.load(std::memory_order_relaxed);
+
+            for (size_t type = 0; type < kMaxRequestTypes; ++type) {
+                if (const ThreadHistogram *histogram = block->requests[type].load(std::memory_order_acquire)) {
+                    histogram->AddTo(requests[type].latency);
+                    requests[type].failures += block->requestFailures[type].load(std::memory_order_relaxed);
+                }
+            }
+        }
+    }
+    metrics.eventsDispatched = metrics.listeners.count;
+
+    const google::protobuf::OneofDescriptor *oneof = FFIRequest::descriptor()->FindOneofByName("message");
+    for (size_t type = 0; type < kMaxRequestTypes; ++type) {
+        RequestMetrics& request = requests[type];
+        if (request.latency.count == 0) {
+            continue;
+        }
+        const google::protobuf::FieldDescriptor *field =
+            type != 0 ? FFIRequest::descriptor()->FindFieldByNumber(static_cast<int>(type)) : nullptr;
+        request.type = field != nullptr && field->containing_oneof() == oneof ? field->name() : "unknown";
+        metrics.requests.push_back(std::move(request));
+    }
+}
+
+}
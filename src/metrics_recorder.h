@@ -0,0 +1,57 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_METRICS_RECORDER_H
+#define LIVEKIT_METRICS_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "livekit/metrics.h"
+
+namespace livekit
+{
+    // Process-wide recorder behind FfiClient::EnableMetrics. Every thread
+    // records into its own block with plain relaxed stores (no contended
+    // cache lines); blocks are merged when a snapshot is taken and handed
+    // over to new threads once their thread exits. While disabled, each
+    // recording site only costs the Enabled() load.
+    class MetricsRecorder
+    {
+    public:
+        static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+        static void SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+        static uint64_t Now() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // `type` is the FFIRequest oneof case
+        static void RecordRequest(int type, uint64_t elapsedNs, bool failed);
+        static void RecordParse(uint64_t elapsedNs, bool failed);
+        static void RecordListeners(uint64_t elapsedNs);
+
+        // Fills the histograms and counters, the FfiClient adds its gauges
+        static void Collect(FfiMetrics& metrics);
+
+    private:
+        static std::atomic<bool> enabled_;
+    };
+}
+
+#endif /* LIVEKIT_METRICS_RECORDER_H */
@@ -0,0 +1,723 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Simulated livekit_ffi, see mock_ffi.h. Replaces the Rust library when the
+// SDK is built with LIVEKIT_MOCK_FFI.
+
+#include "livekit/mock_ffi.h"
+
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "livekit_ffi.h"
+
+namespace livekit
+{
+namespace mock
+{
+
+namespace
+{
+
+using EventCallback = void (*)(const uint8_t *data, size_t len);
+using Clock = std::chrono::steady_clock;
+
+// The handles and what they own: response bytes, buffer memory, or nothing
+// for rooms, streams and sources. Outlives the FfiClient, which drops
+// handles until it is destroyed.
+struct Backend {
+    std::atomic<EventCallback> callback{nullptr};
+    std::atomic<uint64_t> nextId{1};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> emitted{0};
+
+    std::mutex lock;
+    // The map's nodes don't move, the bytes stay put until the handle is dropped
+    std::unordered_map<FfiHandleId, std::string> owned;
+    size_t ownedBytes = 0;
+    SimulatedRoomOptions roomOptions;
+    std::vector<RoomInfo> rooms;
+
+    uint64_t NextId() { return nextId.fetch_add(1, std::memory_order_relaxed); }
+
+    FfiHandleId Own(std::string bytes, char **data = nullptr) {
+        FfiHandleId handle = NextId();
+        std::lock_guard<std::mutex> guard(lock);
+        ownedBytes += bytes.size();
+        std::string& stored = owned.emplace(handle, std::move(bytes)).first->second;
+        if (data) {
+            *data = &stored[0];
+        }
+        return handle;
+    }
+
+    bool Drop(FfiHandleId handle) {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = owned.find(handle);
+        if (it == owned.end()) {
+            return false;
+        }
+        ownedBytes -= it->second.size();
+        owned.erase(it);
+        return true;
+    }
+};
+
+Backend& GetBackend() {
+    static Backend backend;
+    return backend;
+}
+
+// Emits events once due, from its own thread, as the Rust runtime completes
+// async requests. First used after the FfiClient is initialized, so it is
+// destroyed before it, dropping what is still pending.
+class Completer
+{
+public:
+    Completer() : thread_(&Completer::Run, this) {}
+
+    ~Completer() {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stopped_ = true;
+        }
+        wakeup_.notify_all();
+        thread_.join();
+    }
+
+    void Post(Clock::time_point due, std::string bytes) {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            // Events due at the same time keep their order
+            pending_.emplace(due, std::move(bytes));
+        }
+        wakeup_.notify_one();
+    }
+
+    void Post(Clock::time_point due, const FFIEvent& event) { Post(due, event.SerializeAsString()); }
+
+private:
+    std::mutex lock_;
+    std::condition_variable wakeup_;
+    std::multimap<Clock::time_point, std::string> pending_;
+    bool stopped_{false};
+    std::thread thread_;
+
+    void Run() {
+        std::unique_lock<std::mutex> guard(lock_);
+        while (!stopped_) {
+            if (pending_.empty()) {
+                wakeup_.wait(guard);
+                continue;
+            }
+            auto next = pending_.begin();
+            if (next->first > Clock::now()) {
+                wakeup_.wait_until(guard, next->first);
+                continue;
+            }
+            std::string bytes = std::move(next->second);
+            pending_.erase(next);
+            guard.unlock();
+            EmitEvent(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+            guard.lock();
+        }
+    }
+};
+
+Completer& GetCompleter() {
+    static Completer completer;
+    return completer;
+}
+
+// Zero-filled planes laid out as the Rust side does, no padding
+void AllocVideoBuffer(VideoFrameBufferType type, uint32_t width, uint32_t height, VideoFrameBufferInfo *info) {
+    const uint32_t chromaWidth = type == VideoFrameBufferType::I444 ? width : (width + 1) / 2;
+    const uint32_t chromaHeight =
+        type == VideoFrameBufferType::I444 || type == VideoFrameBufferType::I422 ? height : (height + 1) / 2;
+    const size_t bytesPerSample = type == VideoFrameBufferType::I010 ? 2 : 1;
+    const size_t lumaSize = static_cast<size_t>(width) * height * bytesPerSample;
+    const size_t chromaSize = static_cast<size_t>(chromaWidth) * chromaHeight * bytesPerSample;
+
+    info->set_buffer_type(type);
+    info->set_width(width);
+    info->set_height(height);
+
+    char *data = nullptr;
+    switch (type) {
+        case VideoFrameBufferType::NATIVE:
+            info->mutable_handle()->set_id(GetBackend().Own(std::string()));
+            info->mutable_native();
+            return;
+        case VideoFrameBufferType::NV12: {
+            info->mutable_handle()->set_id(GetBackend().Own(std::string(lumaSize + 2 * chromaSize, '\0'), &data));
+            BiplanarYuvBufferInfo *biYuv = info->mutable_bi_yuv();
+            biYuv->set_chroma_width(chromaWidth);
+            biYuv->set_chroma_height(chromaHeight);
+            biYuv->set_stride_y(width);
+            biYuv->set_stride_uv(chromaWidth * 2);
+            biYuv->set_data_y_ptr(reinterpret_cast<uintptr_t>(data));
+            biYuv->set_data_uv_ptr(reinterpret_cast<uintptr_t>(data + lumaSize));
+            return;
+        }
+        default: {
+            const bool alpha = type == VideoFrameBufferType::I420A;
+            const size_t size = lumaSize * (alpha ? 2 : 1) + 2 * chromaSize;
+            info->mutable_handle()->set_id(GetBackend().Own(std::string(size, '\0'), &data));
+            const uint32_t strideScale = static_cast<uint32_t>(bytesPerSample);
+            PlanarYuvBufferInfo *yuv = info->mutable_yuv();
+            yuv->set_chroma_width(chromaWidth);
+            yuv->set_chroma_height(chromaHeight);
+            yuv->set_stride_y(width * strideScale);
+            yuv->set_stride_u(chromaWidth * strideScale);
+            yuv->set_stride_v(chromaWidth * strideScale);
+            yuv->set_data_y_ptr(reinterpret_cast<uintptr_t>(data));
+            yuv->set_data_u_ptr(reinterpret_cast<uintptr_t>(data + lumaSize));
+            yuv->set_data_v_ptr(reinterpret_cast<uintptr_t>(data + lumaSize + chromaSize));
+            if (alpha) {
+                yuv->set_stride_a(width);
+                yuv->set_data_a_ptr(reinterpret_cast<uintptr_t>(data + lumaSize + 2 * chromaSize));
+            }
+            return;
+        }
+    }
+}
+
+void AllocAudioBuffer(uint32_t sampleRate, uint32_t numChannels, uint32_t samplesPerChannel,
+                      AudioFrameBufferInfo *info) {
+    char *data = nullptr;
+    size_t size = static_cast<size_t>(numChannels) * samplesPerChannel * sizeof(int16_t);
+    info->mutable_handle()->set_id(GetBackend().Own(std::string(size, '\0'), &data));
+    info->set_data_ptr(reinterpret_cast<uintptr_t>(data));
+    info->set_num_channels(numChannels);
+    info->set_sample_rate(sampleRate);
+    info->set_samples_per_channel(samplesPerChannel);
+}
+
+void AddPublication(ParticipantInfo *participant, const std::string& sid, TrackKind kind) {
+    TrackPublicationInfo *publication = participant->add_publications();
+    publication->set_sid(sid);
+    publication->set_name(sid);
+    publication->set_kind(kind);
+    publication->set_remote(true);
+    if (kind == TrackKind::KIND_VIDEO) {
+        publication->set_source(TrackSource::SOURCE_CAMERA);
+        publication->set_simulcasted(true);
+        publication->set_width(1280);
+        publication->set_height(720);
+        publication->set_mime_type("video/VP8");
+    } else {
+        publication->set_source(TrackSource::SOURCE_MICROPHONE);
+        publication->set_mime_type("audio/opus");
+    }
+}
+
+void Connect(const ConnectRequest& connect, FFIResponse& response) {
+    Backend& backend = GetBackend();
+    uint64_t asyncId = backend.NextId();
+    response.mutable_connect()->mutable_async_id()->set_id(asyncId);
+
+    SimulatedRoomOptions options;
+    {
+        std::lock_guard<std::mutex> guard(backend.lock);
+        options = backend.roomOptions;
+    }
+
+    // Sids are unique over the process, so rooms don't share routes
+    FFIEvent event;
+    ConnectCallback *callback = event.mutable_connect();
+    callback->mutable_async_id()->set_id(asyncId);
+    RoomInfo *room = callback->mutable_room();
+    const std::string id = std::to_string(asyncId);
+    room->mutable_handle()->set_id(backend.Own(std::string()));
+    room->set_sid("RM_mock_" + id);
+    room->set_name("mock-" + id);
+    room->mutable_local_participant()->set_sid("PA_local_" + id);
+    room->mutable_local_participant()->set_identity("local");
+    for (size_t i = 0; i < options.participants; ++i) {
+        ParticipantInfo *participant = room->add_participants();
+        const std::string sid = "PA_" + id + "_" + std::to_string(i);
+        participant->set_sid(sid);
+        participant->set_identity("participant-" + std::to_string(i));
+        participant->set_name(participant->identity());
+        for (size_t track = 0; track < options.audioTracksPerParticipant; ++track) {
+            AddPublication(participant, "TR_" + sid.substr(3) + "_a" + std::to_string(track), TrackKind::KIND_AUDIO);
+        }
+        for (size_t track = 0; track < options.videoTracksPerParticipant; ++track) {
+            AddPublication(participant, "TR_" + sid.substr(3) + "_v" + std::to_string(track), TrackKind::KIND_VIDEO);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(backend.lock);
+        backend.rooms.push_back(*room);
+    }
+
+    Completer& completer = GetCompleter();
+    Clock::time_point due = Clock::now() + options.connectLatency;
+    completer.Post(due, event);
+    if (!connect.options().auto_subscribe()) {
+        return;
+    }
+    for (const ParticipantInfo& participant : room->participants()) {
+        for (const TrackPublicationInfo& publication : participant.publications()) {
+            FFIEvent subscribed;
+            RoomEvent *roomEvent = subscribed.mutable_room_event();
+            roomEvent->set_room_sid(room->sid());
+            TrackSubscribed *trackSubscribed = roomEvent->mutable_track_subscribed();
+            trackSubscribed->set_participant_sid(participant.sid());
+            TrackInfo *track = trackSubscribed->mutable_track();
+            track->set_sid(publication.sid());
+            track->set_name(publication.name());
+            track->set_kind(publication.kind());
+            track->set_stream_state(StreamState::STATE_ACTIVE);
+            track->set_remote(true);
+            completer.Post(due, subscribed);
+        }
+    }
+}
+
+void Disconnect(const DisconnectRequest& disconnect, FFIResponse& response) {
+    Backend& backend = GetBackend();
+    uint64_t asyncId = backend.NextId();
+    response.mutable_disconnect()->mutable_async_id()->set_id(asyncId);
+    {
+        std::lock_guard<std::mutex> guard(backend.lock);
+        for (auto it = backend.rooms.begin(); it != backend.rooms.end(); ++it) {
+            if (it->handle().id() == disconnect.room_handle().id()) {
+                backend.rooms.erase(it);
+                break;
+            }
+        }
+    }
+
+    FFIEvent event;
+    event.mutable_disconnect()->mutable_async_id()->set_id(asyncId);
+    GetCompleter().Post(Clock::now(), event);
+}
+
+// Async requests completing successfully right away
+template<typename Response, typename Callback>
+void Complete(Response *response, Callback *callback, FFIEvent& event) {
+    uint64_t asyncId = GetBackend().NextId();
+    response->mutable_async_id()->set_id(asyncId);
+    callback->mutable_async_id()->set_id(asyncId);
+    GetCompleter().Post(Clock::now(), event);
+}
+
+void Answer(const FFIRequest& request, FFIResponse& response) {
+    Backend& backend = GetBackend();
+    FFIEvent event;
+    switch (request.message_case()) {
+        case FFIRequest::kInitialize:
+            backend.callback.store(reinterpret_cast<EventCallback>(request.initialize().event_callback_ptr()));
+            response.mutable_initialize();
+            break;
+        case FFIRequest::kDispose:
+            response.mutable_dispose();
+            if (request.dispose().async()) {
+                Complete(response.mutable_dispose(), event.mutable_dispose(), event);
+            }
+            break;
+        case FFIRequest::kConnect:
+            Connect(request.connect(), response);
+            break;
+        case FFIRequest::kDisconnect:
+            Disconnect(request.disconnect(), response);
+            break;
+        case FFIRequest::kPublishTrack: {
+            PublishTrackCallback *callback = event.mutable_publish_track();
+            callback->mutable_publication()->set_sid("TR_pub_" + std::to_string(backend.NextId()));
+            callback->mutable_publication()->set_source(request.publish_track().options().source());
+            Complete(response.mutable_publish_track(), callback, event);
+            break;
+        }
+        case FFIRequest::kUnpublishTrack:
+            Complete(response.mutable_unpublish_track(), event.mutable_unpublish_track(), event);
+            break;
+        case FFIRequest::kPublishData:
+            Complete(response.mutable_publish_data(), event.mutable_publish_data(), event);
+            break;
+        case FFIRequest::kSetSubscribed:
+            response.mutable_set_subscribed();
+            break;
+        case FFIRequest::kUpdateTrackSettings:
+            response.mutable_update_track_settings();
+            break;
+        case FFIRequest::kCreateVideoTrack:
+        case FFIRequest::kCreateAudioTrack: {
+            bool video = request.has_create_video_track();
+            TrackInfo *track = video ? response.mutable_create_video_track()->mutable_track()
+                                     : response.mutable_create_audio_track()->mutable_track();
+            track->mutable_opt_handle()->set_id(backend.Own(std::string()));
+            track->set_sid("TR_local_" + std::to_string(track->opt_handle().id()));
+            track->set_name(video ? request.create_video_track().name() : request.create_audio_track().name());
+            track->set_kind(video ? TrackKind::KIND_VIDEO : TrackKind::KIND_AUDIO);
+            track->set_stream_state(StreamState::STATE_ACTIVE);
+            break;
+        }
+        case FFIRequest::kAllocVideoBuffer: {
+            const AllocVideoBufferRequest& alloc = request.alloc_video_buffer();
+            AllocVideoBuffer(alloc.type(), alloc.width(), alloc.height(),
+                             response.mutable_alloc_video_buffer()->mutable_buffer());
+            break;
+        }
+        case FFIRequest::kNewVideoStream: {
+            VideoStreamInfo *stream = response.mutable_new_video_stream()->mutable_stream();
+            stream->mutable_handle()->set_id(backend.Own(std::string()));
+            stream->set_type(request.new_video_stream().type());
+            stream->set_track_sid(request.new_video_stream().track_sid());
+            break;
+        }
+        case FFIRequest::kNewVideoSource: {
+            VideoSourceInfo *source = response.mutable_new_video_source()->mutable_source();
+            source->mutable_handle()->set_id(backend.Own(std::string()));
+            source->set_type(request.new_video_source().type());
+            break;
+        }
+        case FFIRequest::kCaptureVideoFrame:
+            response.mutable_capture_video_frame();
+            break;
+        case FFIRequest::kToI420: {
+            // Only the size of ARGB sources is known here
+            const ToI420Request& toI420 = request.to_i420();
+            if (toI420.has_argb()) {
+                AllocVideoBuffer(VideoFrameBufferType::I420, toI420.argb().width(), toI420.argb().height(),
+                                 response.mutable_to_i420()->mutable_buffer());
+            }
+            break;
+        }
+        case FFIRequest::kToArgb:
+            response.mutable_to_argb();
+            break;
+        case FFIRequest::kAllocAudioBuffer: {
+            const AllocAudioBufferRequest& alloc = request.alloc_audio_buffer();
+            AllocAudioBuffer(alloc.sample_rate(), alloc.num_channels(), alloc.samples_per_channel(),
+                             response.mutable_alloc_audio_buffer()->mutable_buffer());
+            break;
+        }
+        case FFIRequest::kNewAudioStream: {
+            AudioStreamInfo *stream = response.mutable_new_audio_stream()->mutable_stream();
+            stream->mutable_handle()->set_id(backend.Own(std::string()));
+            stream->set_type(request.new_audio_stream().type());
+            stream->set_track_sid(request.new_audio_stream().track_sid());
+            break;
+        }
+        case FFIRequest::kNewAudioSource: {
+            AudioSourceInfo *source = response.mutable_new_audio_source()->mutable_source();
+            source->mutable_handle()->set_id(backend.Own(std::string()));
+            source->set_type(request.new_audio_source().type());
+            break;
+        }
+        case FFIRequest::kCaptureAudioFrame:
+            response.mutable_capture_audio_frame();
+            break;
+        case FFIRequest::kNewAudioResampler:
+            response.mutable_new_audio_resampler()->mutable_handle()->set_id(backend.Own(std::string()));
+            break;
+        case FFIRequest::kRemixAndResample: {
+            // The input isn't tracked, 10ms of output
+            const RemixAndResampleRequest& remix = request.remix_and_resample();
+            AllocAudioBuffer(remix.sample_rate(), remix.num_channels(), remix.sample_rate() / 100,
+                             response.mutable_remix_and_resample()->mutable_buffer());
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Fresh backend buffers for the frame, samples or data an event points to
+void AttachBuffers(FFIEvent& event, const std::string& payload) {
+    if (event.has_video_stream_event() && event.video_stream_event().has_frame_received()) {
+        VideoFrameBufferInfo *buffer = event.mutable_video_stream_event()->mutable_frame_received()->mutable_buffer();
+        AllocVideoBuffer(buffer->buffer_type(), buffer->width(), buffer->height(), buffer);
+    } else if (event.has_audio_stream_event() && event.audio_stream_event().has_frame_received()) {
+        AudioFrameBufferInfo *frame = event.mutable_audio_stream_event()->mutable_frame_received()->mutable_frame();
+        AllocAudioBuffer(frame->sample_rate(), frame->num_channels(), frame->samples_per_channel(), frame);
+    } else if (event.has_room_event() && event.room_event().has_data_received()) {
+        DataReceived *data = event.mutable_room_event()->mutable_data_received();
+        char *bytes = nullptr;
+        data->mutable_handle()->set_id(GetBackend().Own(payload, &bytes));
+        data->set_data_ptr(reinterpret_cast<uintptr_t>(bytes));
+        data->set_data_size(payload.size());
+    }
+}
+
+bool NeedsBuffers(const FFIEvent& event) {
+    return (event.has_video_stream_event() && event.video_stream_event().has_frame_received()) ||
+           (event.has_audio_stream_event() && event.audio_stream_event().has_frame_received()) ||
+           (event.has_room_event() && event.room_event().has_data_received());
+}
+
+}
+
+void SetRoomOptions(const SimulatedRoomOptions& options) {
+    Backend& backend = GetBackend();
+    std::lock_guard<std::mutex> guard(backend.lock);
+    backend.roomOptions = options;
+}
+
+std::vector<RoomInfo> GetRooms() {
+    Backend& backend = GetBackend();
+    std::lock_guard<std::mutex> guard(backend.lock);
+    return backend.rooms;
+}
+
+void EmitEvent(const uint8_t *data, size_t len) {
+    Backend& backend = GetBackend();
+    if (EventCallback callback = backend.callback.load()) {
+        backend.emitted.fetch_add(1, std::memory_order_relaxed);
+        callback(data, len);
+    }
+}
+
+void EmitEvent(const FFIEvent& event) {
+    std::string bytes = event.SerializeAsString();
+    EmitEvent(reinterpret_cast<const uint8_t *>(bytes.data()), bytes.size());
+}
+
+void EmitVideoFrame(uint64_t streamHandle, VideoFrameBufferType type, uint32_t width, uint32_t height,
+                    int64_t timestampUs) {
+    FFIEvent event;
+    VideoStreamEvent *stream = event.mutable_video_stream_event();
+    stream->mutable_handle()->set_id(streamHandle);
+    FrameReceived *frame = stream->mutable_frame_received();
+    frame->mutable_frame()->set_timestamp_us(timestampUs);
+    AllocVideoBuffer(type, width, height, frame->mutable_buffer());
+    EmitEvent(event);
+}
+
+MockStats GetStats() {
+    Backend& backend = GetBackend();
+    MockStats stats;
+    stats.requests = backend.requests.load(std::memory_order_relaxed);
+    stats.eventsEmitted = backend.emitted.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> guard(backend.lock);
+    stats.liveHandles = backend.owned.size();
+    stats.liveBytes = backend.ownedBytes;
+    return stats;
+}
+
+std::vector<LoggedEvent> GenerateTraffic(const RoomInfo& room, size_t count,
+                                         std::chrono::microseconds interval, const TrafficOptions& options) {
+    std::vector<LoggedEvent> events;
+    if (room.participants_size() == 0) {
+        return events;
+    }
+    events.reserve(count);
+
+    // mt19937_64 and plain modulo, so a seed gives the same events everywhere
+    std::mt19937_64 random(options.seed);
+    const uint64_t kinds = options.dataBytes > 0 ? 5 : 4;
+    for (size_t i = 0; i < count; ++i) {
+        const ParticipantInfo& participant = room.participants(static_cast<int>(random() % room.participants_size()));
+
+        FFIEvent event;
+        RoomEvent *roomEvent = event.mutable_room_event();
+        roomEvent->set_room_sid(room.sid());
+        LoggedEvent logged;
+        switch (random() % kinds) {
+            case 0:
+            case 1: {
+                if (participant.publications_size() == 0) {
+                    roomEvent->mutable_connection_quality_changed()->set_participant_sid(participant.sid());
+                    break;
+                }
+                const std::string& track =
+                    participant.publications(static_cast<int>(random() % participant.publications_size())).sid();
+                if (random() % 2 == 0) {
+                    roomEvent->mutable_track_muted()->set_participant_sid(participant.sid());
+                    roomEvent->mutable_track_muted()->set_track_sid(track);
+                } else {
+                    roomEvent->mutable_track_unmuted()->set_participant_sid(participant.sid());
+                    roomEvent->mutable_track_unmuted()->set_track_sid(track);
+                }
+                break;
+            }
+            case 2: {
+                ActiveSpeakersChanged *speakers = roomEvent->mutable_speakers_changed();
+                size_t speakerCount = 1 + random() % 3;
+                for (size_t s = 0; s < speakerCount; ++s) {
+                    speakers->add_participant_sids(
+                        room.participants(static_cast<int>(random() % room.participants_size())).sid());
+                }
+                break;
+            }
+            case 3: {
+                ConnectionQualityChanged *quality = roomEvent->mutable_connection_quality_changed();
+                quality->set_participant_sid(participant.sid());
+                quality->set_quality(static_cast<ConnectionQuality>(random() % 3));
+                break;
+            }
+            default: {
+                DataReceived *data = roomEvent->mutable_data_received();
+                data->set_participant_sid(participant.sid());
+                data->set_kind(random() % 2 == 0 ? DataPacketKind::KIND_RELIABLE : DataPacketKind::KIND_LOSSY);
+                logged.payload.resize(options.dataBytes);
+                for (char& byte : logged.payload) {
+                    byte = static_cast<char>(random());
+                }
+                break;
+            }
+        }
+        logged.offset = interval * static_cast<int64_t>(i);
+        logged.bytes = event.SerializeAsString();
+        events.push_back(std::move(logged));
+    }
+    return events;
+}
+
+Replayer::Replayer(const std::vector<LoggedEvent>& events, const ReplayOptions& options) : options_(options) {
+    if (options.speed < 0 || options.eventsPerSecond < 0) {
+        throw std::invalid_argument("the replay speed and rate can't be negative");
+    }
+
+    events_.reserve(events.size());
+    for (const LoggedEvent& logged : events) {
+        Prepared prepared;
+        prepared.offset = logged.offset;
+        if (!prepared.event.ParseFromString(logged.bytes)) {
+            throw std::invalid_argument("a logged event doesn't decode");
+        }
+        prepared.needsBuffers = NeedsBuffers(prepared.event);
+        bool moved = !options.roomSid.empty() && prepared.event.has_room_event();
+        if (moved) {
+            prepared.event.mutable_room_event()->set_room_sid(options.roomSid);
+        }
+        if (prepared.needsBuffers) {
+            prepared.payload = logged.payload;
+        } else {
+            prepared.bytes = moved ? prepared.event.SerializeAsString() : logged.bytes;
+            prepared.event.Clear();
+        }
+        events_.push_back(std::move(prepared));
+    }
+    thread_ = std::thread(&Replayer::Run, this);
+}
+
+Replayer::~Replayer() {
+    Stop();
+    thread_.join();
+}
+
+void Replayer::Stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stopped_ = true;
+    }
+    wakeup_.notify_all();
+}
+
+void Replayer::Wait() {
+    std::unique_lock<std::mutex> guard(lock_);
+    wakeup_.wait(guard, [this]() { return done_; });
+}
+
+void Replayer::Run() {
+    const bool paced = options_.eventsPerSecond > 0 || options_.speed > 0;
+    const std::chrono::duration<double, std::micro> period(
+        options_.eventsPerSecond > 0 ? 1e6 / options_.eventsPerSecond : 0);
+
+    uint64_t index = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t loop = 0; !events_.empty() && (options_.loops == 0 || loop < options_.loops); ++loop) {
+        // The recorded timing restarts with every loop, the fixed rate goes on
+        if (options_.eventsPerSecond == 0) {
+            start = Clock::now();
+        }
+        for (size_t i = 0; i < events_.size(); ++i) {
+            const Prepared& prepared = events_[i];
+            Clock::time_point due;
+            if (paced) {
+                if (options_.eventsPerSecond > 0) {
+                    due = start + std::chrono::duration_cast<Clock::duration>(period * static_cast<double>(index));
+                } else {
+                    due = start + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double, std::micro>(prepared.offset.count() / options_.speed));
+                }
+                std::unique_lock<std::mutex> guard(lock_);
+                wakeup_.wait_until(guard, due, [this]() { return stopped_; });
+                if (stopped_) {
+                    break;
+                }
+                guard.unlock();
+                lagUs_.store(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count(),
+                             std::memory_order_relaxed);
+            } else {
+                std::lock_guard<std::mutex> guard(lock_);
+                if (stopped_) {
+                    break;
+                }
+                due = Clock::now();
+            }
+
+            if (options_.onEmit) {
+                options_.onEmit(i, due);
+            }
+            if (prepared.needsBuffers) {
+                FFIEvent event = prepared.event;
+                AttachBuffers(event, prepared.payload);
+                EmitEvent(event);
+            } else {
+                EmitEvent(reinterpret_cast<const uint8_t *>(prepared.bytes.data()), prepared.bytes.size());
+            }
+            emitted_.fetch_add(1, std::memory_order_relaxed);
+            ++index;
+        }
+
+        std::lock_guard<std::mutex> guard(lock_);
+        if (stopped_) {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        done_ = true;
+    }
+    wakeup_.notify_all();
+}
+
+}
+}
+
+using namespace livekit;
+
+extern "C" FfiHandleId livekit_ffi_request(const uint8_t *data, size_t len, const uint8_t **res_ptr, size_t *res_len) {
+    mock::Backend& backend = mock::GetBackend();
+    backend.requests.fetch_add(1, std::memory_order_relaxed);
+
+    FFIRequest request;
+    if (!request.ParseFromArray(data, static_cast<int>(len))) {
+        return INVALID_HANDLE;
+    }
+
+    FFIResponse response;
+    mock::Answer(request, response);
+
+    char *bytes = nullptr;
+    std::string encoded = response.SerializeAsString();
+    size_t size = encoded.size();
+    FfiHandleId handle = backend.Own(std::move(encoded), &bytes);
+    *res_ptr = reinterpret_cast<const uint8_t *>(bytes);
+    *res_len = size;
+    return handle;
+}
+
+extern "C" bool livekit_ffi_drop_handle(FfiHandleId handle) {
+    return mock::GetBackend().Drop(handle);
+}
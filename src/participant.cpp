@@ -0,0 +1,50 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/participant.h"
+
+namespace livekit
+{
+
+TrackPublication TrackPublication::FromInfo(const TrackPublicationInfo& info) {
+    TrackPublication publication;
+    publication.sid = info.sid();
+    publication.name = info.name();
+    publication.kind = info.kind();
+    publication.source = info.source();
+    publication.simulcasted = info.simulcasted();
+    publication.width = info.width();
+    publication.height = info.height();
+    publication.mimeType = info.mime_type();
+    publication.muted = info.muted();
+    publication.remote = info.remote();
+    return publication;
+}
+
+Participant Participant::FromInfo(const ParticipantInfo& info) {
+    Participant participant;
+    participant.sid = info.sid();
+    participant.identity = info.identity();
+    participant.name = info.name();
+    participant.metadata = info.metadata();
+    participant.publications.reserve(info.publications_size());
+    for (const TrackPublicationInfo& publication : info.publications()) {
+        participant.publications.push_back(TrackPublication::FromInfo(publication));
+    }
+    return participant;
+}
+
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "participant_cache.h"
+
+#include <mutex>
+
+namespace livekit
+{
+
+void ParticipantCache::Reset(const RoomInfo& info) {
+    std::unique_lock<std::shared_mutex> guard(lock_);
+    sid_ = info.sid();
+    name_ = info.name();
+    metadata_ = info.metadata();
+    local_ = Participant::FromInfo(info.local_participant());
+
+    participants_.clear();
+    participantIndex_.clear();
+    identityIndex_.clear();
+    trackIndex_.clear();
+    participants_.reserve(info.participants_size());
+    for (const ParticipantInfo& participant : info.participants()) {
+        AddParticipant(participant);
+    }
+}
+
+void ParticipantCache::Apply(const RoomEvent& event) {
+    std::unique_lock<std::shared_mutex> guard(lock_);
+    switch (event.message_case()) {
+        case RoomEvent::kParticipantConnected:
+            AddParticipant(event.participant_connected().info());
+            break;
+        case RoomEvent::kParticipantDisconnected:
+            RemoveParticipant(event.participant_disconnected().participant_sid());
+            break;
+        case RoomEvent::kTrackPublished:
+            AddPublication(event.track_published().participant_sid(), event.track_published().publication());
+            break;
+        case RoomEvent::kTrackUnpublished:
+            RemovePublication(event.track_unpublished().publication_sid());
+            break;
+        case RoomEvent::kTrackSubscribed:
+            if (TrackPublication *publication = FindPublication(event.track_subscribed().track().sid())) {
+                publication->subscribed = true;
+            }
+            break;
+        case RoomEvent::kTrackUnsubscribed:
+            if (TrackPublication *publication = FindPublication(event.track_unsubscribed().track_sid())) {
+                publication->subscribed = false;
+            }
+            break;
+        case RoomEvent::kTrackMuted:
+            if (TrackPublication *publication = FindPublication(event.track_muted().track_sid())) {
+                publication->muted = true;
+            }
+            break;
+        case RoomEvent::kTrackUnmuted:
+            if (TrackPublication *publication = FindPublication(event.track_unmuted().track_sid())) {
+                publication->muted = false;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+std::string ParticipantCache::GetSid() const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    return sid_;
+}
+
+std::string ParticipantCache::GetName() const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    return name_;
+}
+
+std::string ParticipantCache::GetMetadata() const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    return metadata_;
+}
+
+Participant ParticipantCache::GetLocalParticipant() const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    return local_;
+}
+
+std::optional<Participant> ParticipantCache::GetParticipant(const std::string& sid) const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    auto it = participantIndex_.find(sid);
+    if (it == participantIndex_.end()) {
+        return std::nullopt;
+    }
+    return participants_[it->second];
+}
+
+std::optional<Participant> ParticipantCache::GetParticipantByIdentity(const std::string& identity) const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    auto it = identityIndex_.find(identity);
+    if (it == identityIndex_.end()) {
+        return std::nullopt;
+    }
+    return participants_[it->second];
+}
+
+std::optional<TrackPublication> ParticipantCache::GetTrackPublication(const std::string& trackSid) const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    auto it = trackIndex_.find(trackSid);
+    if (it == trackIndex_.end()) {
+        return std::nullopt;
+    }
+    return participants_[it->second.participant].publications[it->second.publication];
+}
+
+std::vector<Participant> ParticipantCache::GetParticipants() const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    return participants_;
+}
+
+size_t ParticipantCache::GetParticipantCount() const {
+    std::shared_lock<std::shared_mutex> guard(lock_);
+    return participants_.size();
+}
+
+void ParticipantCache::AddParticipant(const ParticipantInfo& info) {
+    if (participantIndex_.count(info.sid()) != 0) {
+        // Already known (e.g. listed in the RoomInfo and connected again),
+        // drop the old state first
+        RemoveParticipant(info.sid());
+    }
+
+    participants_.push_back(Participant::FromInfo(info));
+    IndexParticipant(participants_.size() - 1);
+}
+
+void ParticipantCache::RemoveParticipant(const std::string& sid) {
+    auto it = participantIndex_.find(sid);
+    if (it == participantIndex_.end()) {
+        return;
+    }
+
+    size_t index = it->second;
+    Participant& participant = participants_[index];
+    for (const TrackPublication& publication : participant.publications) {
+        trackIndex_.erase(publication.sid);
+    }
+    // A participant reconnecting with the same identity may already have
+    // taken the entry over
+    auto identity = identityIndex_.find(participant.identity);
+    if (identity != identityIndex_.end() && identity->second == index) {
+        identityIndex_.erase(identity);
+    }
+    participantIndex_.erase(it);
+
+    size_t last = participants_.size() - 1;
+    if (index != last) {
+        participant = std::move(participants_.back());
+        participants_.pop_back();
+        IndexParticipant(index, last);
+    } else {
+        participants_.pop_back();
+    }
+}
+
+void ParticipantCache::AddPublication(const std::string& participantSid, const TrackPublicationInfo& info) {
+    auto it = participantIndex_.find(participantSid);
+    if (it == participantIndex_.end()) {
+        return;
+    }
+
+    if (TrackPublication *publication = FindPublication(info.sid())) {
+        // Republished, keep the subscription state
+        bool subscribed = publication->subscribed;
+        *publication = TrackPublication::FromInfo(info);
+        publication->subscribed = subscribed;
+        return;
+    }
+
+    std::vector<TrackPublication>& publications = participants_[it->second].publications;
+    publications.push_back(TrackPublication::FromInfo(info));
+    trackIndex_[info.sid()] = TrackLocation{it->second, publications.size() - 1};
+}
+
+void ParticipantCache::RemovePublication(const std::string& trackSid) {
+    auto it = trackIndex_.find(trackSid);
+    if (it == trackIndex_.end()) {
+        return;
+    }
+
+    TrackLocation location = it->second;
+    trackIndex_.erase(it);
+
+    std::vector<TrackPublication>& publications = participants_[location.participant].publications;
+    if (location.publication != publications.size() - 1) {
+        publications[location.publication] = std::move(publications.back());
+        trackIndex_[publications[location.publication].sid].publication = location.publication;
+    }
+    publications.pop_back();
+}
+
+TrackPublication *ParticipantCache::FindPublication(const std::string& trackSid) {
+    auto it = trackIndex_.find(trackSid);
+    if (it == trackIndex_.end()) {
+        return nullptr;
+    }
+    return &participants_[it->second.participant].publications[it->second.publication];
+}
+
+void ParticipantCache::IndexParticipant(size_t index, size_t movedFrom) {
+    const Participant& participant = participants_[index];
+    participantIndex_[participant.sid] = index;
+    // A moved participant keeps the identity only if it had it
+    auto identity = identityIndex_.find(participant.identity);
+    if (movedFrom == SIZE_MAX || (identity != identityIndex_.end() && identity->second == movedFrom)) {
+        identityIndex_[participant.identity] = index;
+    }
+    for (size_t i = 0; i < participant.publications.size(); ++i) {
+        trackIndex_[participant.publications[i].sid] = TrackLocation{index, i};
+    }
+}
+
+}
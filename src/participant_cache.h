@@ -0,0 +1,82 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_PARTICIPANT_CACHE_H
+#define LIVEKIT_PARTICIPANT_CACHE_H
+
+#include <cstdint>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "livekit/participant.h"
+#include "room.pb.h"
+
+namespace livekit
+{
+    // Participants and publications of a room, updated incrementally from
+    // its RoomEvents. Remote participants are stored contiguously and
+    // indexed by sid, so are their tracks; removals swap with the last
+    // element and fix the indices of the moved one. Writers (the dispatch
+    // thread) take the lock exclusively, lookups share it and copy out.
+    class ParticipantCache
+    {
+    public:
+        void Reset(const RoomInfo& info);
+        void Apply(const RoomEvent& event);
+
+        std::string GetSid() const;
+        std::string GetName() const;
+        std::string GetMetadata() const;
+
+        Participant GetLocalParticipant() const;
+        std::optional<Participant> GetParticipant(const std::string& sid) const;
+        std::optional<Participant> GetParticipantByIdentity(const std::string& identity) const;
+        std::optional<TrackPublication> GetTrackPublication(const std::string& trackSid) const;
+        std::vector<Participant> GetParticipants() const;
+        size_t GetParticipantCount() const;
+
+    private:
+        struct TrackLocation {
+            size_t participant;
+            size_t publication;
+        };
+
+        mutable std::shared_mutex lock_;
+        std::string sid_;
+        std::string name_;
+        std::string metadata_;
+        Participant local_;
+
+        std::vector<Participant> participants_;
+        std::unordered_map<std::string, size_t> participantIndex_;
+        std::unordered_map<std::string, size_t> identityIndex_;
+        std::unordered_map<std::string, TrackLocation> trackIndex_;
+
+        void AddParticipant(const ParticipantInfo& info);
+        void RemoveParticipant(const std::string& sid);
+        void AddPublication(const std::string& participantSid, const TrackPublicationInfo& info);
+        void RemovePublication(const std::string& trackSid);
+        TrackPublication *FindPublication(const std::string& trackSid);
+        // Indexes participants_[index], `movedFrom` being where it was
+        // indexed before if it was moved there
+        void IndexParticipant(size_t index, size_t movedFrom = SIZE_MAX);
+    };
+}
+
+#endif /* LIVEKIT_PARTICIPANT_CACHE_H */
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/prewarm.h"
+
+#include "livekit/event_view.h"
+#include "livekit/ffi_client.h"
+#include "ffi.pb.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#define LIVEKIT_HAS_GETADDRINFO 1
+#endif
+
+namespace livekit
+{
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+std::chrono::microseconds Since(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+}
+
+struct Endpoint {
+    std::string host;
+    std::string port;
+};
+
+// "wss://user@host:7880/path" gives "host" and "7880", IPv6 brackets are
+// removed. Without a port, the default one of the scheme.
+Endpoint EndpointOf(const std::string& url) {
+    Endpoint endpoint;
+    size_t begin = url.find("://");
+    std::string scheme = begin == std::string::npos ? std::string() : url.substr(0, begin);
+    begin = begin == std::string::npos ? 0 : begin + 3;
+    size_t end = url.find_first_of("/?#", begin);
+    std::string authority = url.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+
+    size_t at = authority.rfind('@');
+    if (at != std::string::npos) {
+        authority.erase(0, at + 1);
+    }
+    size_t portStart = std::string::npos;
+    if (!authority.empty() && authority[0] == '[') {
+        size_t close = authority.find(']');
+        if (close == std::string::npos) {
+            return endpoint;
+        }
+        endpoint.host = authority.substr(1, close - 1);
+        if (close + 1 < authority.size() && authority[close + 1] == ':') {
+            portStart = close + 2;
+        }
+    } else {
+        size_t colon = authority.find(':');
+        endpoint.host = authority.substr(0, colon);
+        if (colon != std::string::npos) {
+            portStart = colon + 1;
+        }
+    }
+
+    if (portStart != std::string::npos && portStart < authority.size()) {
+        endpoint.port = authority.substr(portStart);
+    } else {
+        endpoint.port = scheme == "ws" || scheme == "http" ? "80" : "443";
+    }
+    return endpoint;
+}
+
+bool Resolve(const Endpoint& endpoint) {
+#if defined(LIVEKIT_HAS_GETADDRINFO)
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    if (getaddrinfo(endpoint.host.c_str(), endpoint.port.c_str(), &hints, &addresses) != 0) {
+        return false;
+    }
+    freeaddrinfo(addresses);
+    return true;
+#else
+    (void)endpoint;
+    return false;
+#endif
+}
+
+// What a connect goes through: encoding the request, then decoding its
+// callback through the event path
+void WarmProtobuf() {
+    FFIRequest::descriptor();
+    FFIResponse::descriptor();
+    FFIEvent::descriptor();
+
+    FFIRequest request;
+    request.mutable_connect()->set_url("wss://prewarm");
+    request.mutable_connect()->mutable_options()->set_auto_subscribe(true);
+    std::string requestBytes = request.SerializeAsString();
+    request.ParseFromString(requestBytes);
+
+    FFIEvent event;
+    RoomInfo *room = event.mutable_connect()->mutable_room();
+    room->set_sid("RM_prewarm");
+    room->add_participants()->add_publications()->set_sid("TR_prewarm");
+    std::string eventBytes = event.SerializeAsString();
+    EventView view(reinterpret_cast<const uint8_t *>(eventBytes.data()), eventBytes.size());
+    view.Get();
+}
+
+}
+
+PrewarmStats Prewarm(const PrewarmOptions& options) {
+    PrewarmStats stats;
+
+    Clock::time_point start = Clock::now();
+    FfiClient::getInstance();
+    stats.ffi = Since(start);
+
+    start = Clock::now();
+    WarmProtobuf();
+    stats.protobuf = Since(start);
+
+    Endpoint endpoint = EndpointOf(options.url);
+    if (!endpoint.host.empty()) {
+        start = Clock::now();
+        stats.resolved = Resolve(endpoint);
+        stats.dns = Since(start);
+    }
+    return stats;
+}
+
+}
@@ -0,0 +1,516 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+constexpr char kSegmentMagic[8] = {'L', 'K', 'R', 'E', 'C', '0', '0', '1'};
+
+void Put32(uint8_t *&out, uint32_t value) {
+    std::memcpy(out, &value, sizeof(value));
+    out += sizeof(value);
+}
+
+void PutBytes(uint8_t *&out, const void *data, size_t size) {
+    std::memcpy(out, data, size);
+    out += size;
+}
+
+// Native buffers have no planes to write, the FFI converts them. Null if it
+// can't.
+std::shared_ptr<VideoFrameBuffer> ConvertNative(const VideoFrameBuffer& buffer) {
+    FFIRequest request;
+    request.mutable_to_i420()->mutable_buffer()->set_id(buffer.GetHandle());
+    try {
+        FFIResponse response = FfiClient::getInstance().SendRequest(request);
+        if (!response.has_to_i420() || !response.to_i420().has_buffer()) {
+            return nullptr;
+        }
+        return std::make_shared<VideoFrameBuffer>(response.to_i420().buffer());
+    } catch (const std::exception& e) {
+        std::cerr << "failed to convert a native frame to record: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+}
+
+class Recorder::Writer
+{
+public:
+    explicit Writer(const RecorderOptions& options) : options_(options) {
+        if (!OpenSegment(0)) {
+            throw std::runtime_error("failed to create a recording segment in " + options_.directory);
+        }
+        thread_ = std::thread([this]() { Run(); });
+    }
+
+    ~Writer() { Stop(); }
+
+    // Writes the backlog out and closes the segment, frames queued after
+    // this are dropped
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stopped_ = true;
+        }
+        wakeup_.notify_one();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        CloseSegment();
+    }
+
+    TrackId AddTrack(const std::string& name, TrackKind kind) {
+        TrackId track = nextTrack_.fetch_add(1, std::memory_order_relaxed);
+        Entry entry;
+        entry.type = kTrack;
+        entry.track = track;
+        entry.name = name;
+        entry.kind = kind;
+        entry.size = sizeof(uint32_t) + name.size();
+        Enqueue(std::move(entry));
+        return track;
+    }
+
+    bool WriteVideo(TrackId track, const VideoFrame& frame) {
+        if (!frame.buffer) {
+            return false;
+        }
+        std::shared_ptr<VideoFrameBuffer> buffer = frame.buffer;
+        if (buffer->IsNative()) {
+            buffer = ConvertNative(*buffer);
+            if (!buffer) {
+                std::lock_guard<std::mutex> guard(lock_);
+                ++stats_.droppedFrames;
+                return false;
+            }
+        }
+
+        Entry entry;
+        entry.type = kVideo;
+        entry.track = track;
+        entry.timestampUs = frame.timestampUs;
+        entry.rotation = frame.rotation;
+        entry.size = 5 * sizeof(uint32_t);
+        for (size_t i = 0; i < buffer->NumPlanes(); ++i) {
+            const VideoPlane& plane = buffer->GetPlane(i);
+            entry.size += 3 * sizeof(uint32_t) + static_cast<size_t>(plane.stride) * plane.height;
+        }
+        entry.video = std::move(buffer);
+        return Enqueue(std::move(entry));
+    }
+
+    bool WriteAudio(TrackId track, int64_t timestampUs, std::shared_ptr<const AudioFrameBuffer> buffer) {
+        if (!buffer) {
+            return false;
+        }
+        Entry entry;
+        entry.type = kAudio;
+        entry.track = track;
+        entry.timestampUs = timestampUs;
+        entry.size = 3 * sizeof(uint32_t) + buffer->GetNumSamples() * sizeof(int16_t);
+        entry.audio = std::move(buffer);
+        return Enqueue(std::move(entry));
+    }
+
+    RecorderStats GetStats() const {
+        std::lock_guard<std::mutex> guard(lock_);
+        return stats_;
+    }
+
+private:
+    struct Entry {
+        RecordType type = kTrack;
+        TrackId track = 0;
+        int64_t timestampUs = 0;
+        size_t size = 0;  // of the record, without its header
+        // kTrack
+        std::string name;
+        TrackKind kind = TrackKind::KIND_UNKNOWN;
+        // kVideo
+        std::shared_ptr<VideoFrameBuffer> video;
+        VideoRotation rotation = VideoRotation::VIDEO_ROTATION_0;
+        // kAudio
+        std::shared_ptr<const AudioFrameBuffer> audio;
+
+        size_t Bytes() const { return sizeof(RecordHeader) + size; }
+    };
+
+    RecorderOptions options_;
+    std::atomic<TrackId> nextTrack_{1};
+
+    mutable std::mutex lock_;
+    std::condition_variable wakeup_;
+    std::vector<Entry> pending_;
+    RecorderStats stats_;
+    bool stopped_{false};
+    std::thread thread_;
+
+    // Only used by the writer thread (and the constructor before it starts)
+    std::vector<Entry> tracks_;
+    bool failed_{false};
+    uint32_t segmentIndex_{0};
+    int fd_{-1};
+    uint8_t *map_{nullptr};
+    size_t capacity_{0};
+    size_t used_{0};
+
+    bool Enqueue(Entry entry) {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            // Tracks are tiny and are needed to read the frames back
+            bool full = entry.type != kTrack && stats_.backlogBytes + entry.Bytes() > options_.maxBacklogBytes;
+            bool frame = entry.type != kTrack;
+            if (stopped_ || stats_.failed || full) {
+                stats_.droppedFrames += frame ? 1 : 0;
+                return false;
+            }
+            stats_.backlogBytes += entry.Bytes();
+            stats_.backlogFrames += frame ? 1 : 0;
+            pending_.push_back(std::move(entry));
+            if (pending_.size() != 1) {
+                return true;
+            }
+        }
+        wakeup_.notify_one();
+        return true;
+    }
+
+    void Run() {
+        // Two batches swapped back and forth, so steady state doesn't allocate
+        std::vector<Entry> batch;
+        std::unique_lock<std::mutex> guard(lock_);
+        while (true) {
+            wakeup_.wait(guard, [this]() { return stopped_ || !pending_.empty(); });
+            if (pending_.empty()) {
+                return;
+            }
+            batch.swap(pending_);
+            guard.unlock();
+
+            uint64_t bytes = 0;
+            uint64_t written = 0;
+            uint64_t count = 0;
+            uint64_t frames = 0;
+            uint64_t dropped = 0;
+            for (const Entry& entry : batch) {
+                bool frame = entry.type != kTrack;
+                bytes += entry.Bytes();
+                count += frame ? 1 : 0;
+                if (Write(entry)) {
+                    written += entry.Bytes();
+                    frames += frame ? 1 : 0;
+                } else {
+                    dropped += frame ? 1 : 0;
+                }
+            }
+            // Releases the FFI buffers
+            batch.clear();
+
+            guard.lock();
+            stats_.backlogBytes -= bytes;
+            stats_.backlogFrames -= count;
+            stats_.writtenBytes += written;
+            stats_.writtenFrames += frames;
+            stats_.droppedFrames += dropped;
+        }
+    }
+
+    bool Write(const Entry& entry) {
+        uint8_t *out = Reserve(entry.Bytes());
+        if (out == nullptr) {
+            return false;
+        }
+
+        RecordHeader header{static_cast<uint32_t>(entry.size), entry.type, 0, entry.track, 0, entry.timestampUs};
+        PutBytes(out, &header, sizeof(header));
+        switch (entry.type) {
+            case kTrack:
+                Put32(out, static_cast<uint32_t>(entry.kind));
+                PutBytes(out, entry.name.data(), entry.name.size());
+                tracks_.push_back(entry);
+                break;
+            case kVideo: {
+                const VideoFrameBuffer& buffer = *entry.video;
+                Put32(out, static_cast<uint32_t>(buffer.GetType()));
+                Put32(out, buffer.GetWidth());
+                Put32(out, buffer.GetHeight());
+                Put32(out, static_cast<uint32_t>(entry.rotation));
+                Put32(out, static_cast<uint32_t>(buffer.NumPlanes()));
+                for (size_t i = 0; i < buffer.NumPlanes(); ++i) {
+                    const VideoPlane& plane = buffer.GetPlane(i);
+                    Put32(out, plane.stride);
+                    Put32(out, plane.width);
+                    Put32(out, plane.height);
+                    PutBytes(out, plane.data, static_cast<size_t>(plane.stride) * plane.height);
+                }
+                break;
+            }
+            case kAudio: {
+                const AudioFrameBuffer& buffer = *entry.audio;
+                Put32(out, buffer.GetSampleRate());
+                Put32(out, buffer.GetNumChannels());
+                Put32(out, buffer.GetSamplesPerChannel());
+                PutBytes(out, buffer.GetData(), buffer.GetNumSamples() * sizeof(int16_t));
+                break;
+            }
+        }
+        return true;
+    }
+
+    // Room for a record in the current segment, opening the next one if
+    // needed. Null once a segment couldn't be opened.
+    uint8_t *Reserve(size_t bytes) {
+        if (map_ == nullptr || capacity_ - used_ < bytes) {
+            if (!OpenSegment(bytes)) {
+                return nullptr;
+            }
+        }
+        uint8_t *out = map_ + used_;
+        used_ += bytes;
+        return out;
+    }
+
+    bool OpenSegment(size_t recordBytes) {
+        if (failed_) {
+            return false;
+        }
+        CloseSegment();
+
+        size_t tracksBytes = 0;
+        for (const Entry& track : tracks_) {
+            tracksBytes += track.Bytes();
+        }
+        size_t size = std::max(options_.segmentBytes, sizeof(kSegmentMagic) + tracksBytes + recordBytes);
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "/segment-%06u.lkr", ++segmentIndex_);
+        std::string path = options_.directory + name;
+
+        fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd_ < 0) {
+            return Fail(path, "open");
+        }
+        // Allocated up front: a write to a page the disk has no room for
+        // would fault instead of failing
+#if defined(__linux__)
+        int error = posix_fallocate(fd_, 0, static_cast<off_t>(size));
+#else
+        int error = ftruncate(fd_, static_cast<off_t>(size)) == 0 ? 0 : errno;
+#endif
+        if (error != 0) {
+            errno = error;
+            return Fail(path, "allocate");
+        }
+        void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (map == MAP_FAILED) {
+            return Fail(path, "map");
+        }
+        map_ = static_cast<uint8_t *>(map);
+        capacity_ = size;
+        used_ = 0;
+
+        std::memcpy(map_, kSegmentMagic, sizeof(kSegmentMagic));
+        used_ = sizeof(kSegmentMagic);
+        // Sized to fit, rewriting them adds them back to tracks_
+        std::vector<Entry> tracks;
+        tracks.swap(tracks_);
+        for (const Entry& track : tracks) {
+            Write(track);
+        }
+
+        std::lock_guard<std::mutex> guard(lock_);
+        ++stats_.segments;
+        return true;
+    }
+
+    // Dirty pages stay in the page cache, unmapping doesn't wait for them
+    void CloseSegment() {
+        if (map_ != nullptr) {
+            munmap(map_, capacity_);
+            map_ = nullptr;
+        }
+        if (fd_ >= 0) {
+            if (ftruncate(fd_, static_cast<off_t>(used_)) != 0) {
+                std::cerr << "failed to truncate a recording segment: " << std::strerror(errno) << std::endl;
+            }
+            close(fd_);
+            fd_ = -1;
+        }
+        capacity_ = 0;
+        used_ = 0;
+    }
+
+    bool Fail(const std::string& path, const char *step) {
+        std::cerr << "failed to " << step << " recording segment " << path << ": " << std::strerror(errno)
+                  << std::endl;
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+        failed_ = true;
+        std::lock_guard<std::mutex> guard(lock_);
+        stats_.failed = true;
+        return false;
+    }
+};
+
+Recorder::Recorder(const RecorderOptions& options) : writer_(std::make_shared<Writer>(options))
+{
+}
+
+Recorder::~Recorder()
+{
+    {
+        std::lock_guard<std::mutex> guard(streamsLock_);
+        for (auto& [track, stream] : streams_) {
+            FfiClient::getInstance().RemoveListener(stream.listenerId);
+        }
+        streams_.clear();
+    }
+    // Listeners still running may hold the writer a little longer, their
+    // frames get dropped
+    writer_->Stop();
+}
+
+Recorder::TrackId Recorder::AddTrack(const std::string& name, TrackKind kind)
+{
+    return writer_->AddTrack(name, kind);
+}
+
+bool Recorder::WriteVideo(TrackId track, const VideoFrame& frame)
+{
+    return writer_->WriteVideo(track, frame);
+}
+
+bool Recorder::WriteAudio(TrackId track, int64_t timestampUs, std::shared_ptr<const AudioFrameBuffer> buffer)
+{
+    return writer_->WriteAudio(track, timestampUs, std::move(buffer));
+}
+
+Recorder::TrackId Recorder::RecordTrack(const Room& room, const std::string& participantSid,
+                                        const TrackPublication& publication)
+{
+    uintptr_t roomHandle = room.GetHandle();
+    if (roomHandle == INVALID_HANDLE) {
+        throw std::runtime_error("not connected");
+    }
+
+    FFIRequest request;
+    bool video = publication.kind == TrackKind::KIND_VIDEO;
+    if (video) {
+        NewVideoStreamRequest *newStream = request.mutable_new_video_stream();
+        newStream->mutable_room_handle()->set_id(roomHandle);
+        newStream->set_participant_sid(participantSid);
+        newStream->set_track_sid(publication.sid);
+        newStream->set_type(VideoStreamType::VIDEO_STREAM_NATIVE);
+    } else if (publication.kind == TrackKind::KIND_AUDIO) {
+        NewAudioStreamRequest *newStream = request.mutable_new_audio_stream();
+        newStream->mutable_room_handle()->set_id(roomHandle);
+        newStream->set_participant_sid(participantSid);
+        newStream->set_track_sid(publication.sid);
+        newStream->set_type(AudioStreamType::AUDIO_STREAM_NATIVE);
+    } else {
+        throw std::invalid_argument("only audio and video tracks can be recorded");
+    }
+
+    FFIResponse response = FfiClient::getInstance().SendRequest(request);
+    const FFIHandleId *streamHandle = nullptr;
+    if (video && response.has_new_video_stream()) {
+        streamHandle = &response.new_video_stream().stream().handle();
+    } else if (!video && response.has_new_audio_stream()) {
+        streamHandle = &response.new_audio_stream().stream().handle();
+    }
+    if (streamHandle == nullptr) {
+        throw std::runtime_error("failed to open a stream on " + publication.sid);
+    }
+
+    TrackId track = writer_->AddTrack(publication.sid, publication.kind);
+    Stream stream{FfiHandle(streamHandle->id()), 0};
+
+    std::weak_ptr<Writer> weak = writer_;
+    stream.listenerId = FfiClient::getInstance().AddListener(
+        EventSubscription::ForHandle(streamHandle->id()), [weak, track](const FFIEvent& event) {
+            // The buffers are taken over even when no longer recording, so
+            // they get released
+            std::shared_ptr<Writer> writer = weak.lock();
+            if (event.has_video_stream_event() && event.video_stream_event().has_frame_received()) {
+                VideoFrame frame = VideoFrame::FromEvent(event.video_stream_event().frame_received());
+                if (writer) {
+                    writer->WriteVideo(track, frame);
+                }
+            } else if (event.has_audio_stream_event() && event.audio_stream_event().has_frame_received()) {
+                auto buffer = std::make_shared<const AudioFrameBuffer>(
+                    event.audio_stream_event().frame_received().frame());
+                if (writer) {
+                    int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count();
+                    writer->WriteAudio(track, now, std::move(buffer));
+                }
+            }
+        });
+
+    std::lock_guard<std::mutex> guard(streamsLock_);
+    streams_.emplace(track, std::move(stream));
+    return track;
+}
+
+void Recorder::StopTrack(TrackId track)
+{
+    std::lock_guard<std::mutex> guard(streamsLock_);
+    auto it = streams_.find(track);
+    if (it == streams_.end()) {
+        return;
+    }
+    FfiClient::getInstance().RemoveListener(it->second.listenerId);
+    streams_.erase(it);
+}
+
+RecorderStats Recorder::GetStats() const
+{
+    return writer_->GetStats();
+}
+
+uint64_t Recorder::GetBacklogBytes() const
+{
+    return writer_->GetStats().backlogBytes;
+}
+
+}
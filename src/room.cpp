@@ -17,67 +17,669 @@
 #include "livekit/room.h"
 #include "livekit/ffi_client.h"
 
+#include "data_batcher.h"
 #include "ffi.pb.h"
+#include "participant_cache.h"
 #include "room.pb.h"
+#include "video_sink_set.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
 #include <iostream>
+#include <thread>
 
 namespace livekit
 {
 
+namespace
+{
+
+void SendSetSubscribed(uintptr_t roomHandle, const std::string& participantSid, const std::string& trackSid,
+                       bool subscribed) {
+    SetSubscribedRequest *setSubscribed = new SetSubscribedRequest;
+    setSubscribed->mutable_room_handle()->set_id(roomHandle);
+    setSubscribed->set_participant_sid(participantSid);
+    setSubscribed->set_track_sid(trackSid);
+    setSubscribed->set_subscribe(subscribed);
+
+    FFIRequest request;
+    request.set_allocated_set_subscribed(setSubscribed);
+    FfiClient::getInstance().SendRequest(request);
+}
+
+void SendPublishData(uintptr_t roomHandle, ByteSpan data, DataPacketKind kind,
+                     const std::vector<std::string>& destinationSids) {
+    PublishDataRequest *publish = new PublishDataRequest;
+    publish->mutable_room_handle()->set_id(roomHandle);
+    publish->set_data_ptr(reinterpret_cast<uint64_t>(data.data));
+    publish->set_data_size(data.size);
+    publish->set_kind(kind);
+    for (const std::string& sid : destinationSids) {
+        publish->add_destination_sids(sid);
+    }
+
+    // Fire and forget, like the data channel itself: the PublishDataCallback
+    // isn't waited for
+    FFIRequest request;
+    request.set_allocated_publish_data(publish);
+    FfiClient::getInstance().SendRequest(request);
+}
+
+}
+
+SubscriptionPolicy SubscribeToKind(TrackKind kind)
+{
+    return [kind](const Participant&, const TrackPublication& publication) {
+        return publication.kind == kind;
+    };
+}
+
+SubscriptionPolicy SubscribeToIdentities(std::vector<std::string> identities)
+{
+    return [identities = std::move(identities)](const Participant& participant, const TrackPublication&) {
+        return std::find(identities.begin(), identities.end(), participant.identity) != identities.end();
+    };
+}
+
+struct Room::State {
+    std::mutex lock;
+    FfiHandle handle{INVALID_HANDLE};
+    bool connected{false};
+    // Set by ~Room, a connect completing afterwards releases its room
+    bool closed{false};
+    FfiClient::ListenerId listenerId{0};
+    ParticipantCache cache;
+    // Set before connecting, read-only afterwards
+    SubscriptionPolicy policy;
+    Executor executor;  // the room's strand, if any
+    VideoSinkSet videoSinks;
+    // Swapped atomically, the event thread reads it without the lock
+    std::shared_ptr<const DataHandler> dataHandler;
+    // Set once. Destroyed first, sending what is pending while the handle is valid.
+    std::unique_ptr<DataBatcher> dataBatcher;
+
+    void OnConnect(const std::shared_ptr<State>& self, const ConnectCallback& connectCallback);
+    void OnRoomEvent(const RoomEvent& event);
+    static void DeliverRoomEvent(const std::weak_ptr<State>& weak, const RoomEvent& event);
+    void ApplyPolicyToCache();
+    void OnDataReceived(const DataReceived& received);
+    void ApplyPolicy(const Participant& participant, const TrackPublication& publication);
+    uintptr_t ConnectedHandle();
+    void UpdateTrackSettings(std::unique_lock<std::mutex>& guard, const std::string& trackSid);
+};
+
+Room::Room() : state_(std::make_shared<State>())
+{
+}
+
+Room::~Room()
+{
+    // Events already being dispatched may still find the state alive through
+    // their weak reference, nothing else reaches it after this
+    std::lock_guard<std::mutex> guard(state_->lock);
+    state_->closed = true;
+    if (state_->listenerId != 0) {
+        FfiClient::getInstance().RemoveListener(state_->listenerId);
+    }
+}
+
 void Room::Connect(const std::string& url, const std::string& token)
 {
-   std::lock_guard<std::mutex> guard(lock_);
-    if (connected_) {
-        throw std::runtime_error("already connected");
+    Connect(url, token, nullptr);
+}
+
+void Room::Connect(const std::string& url, const std::string& token, ConnectHandler handler)
+{
+    Connect(url, token, ConnectOptions{}, std::move(handler));
+}
+
+void Room::Connect(const std::string& url, const std::string& token, const ConnectOptions& options,
+                   ConnectHandler handler)
+{
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        if (state_->connected) {
+            throw std::runtime_error("already connected");
+        }
+
+        state_->connected = true;
+        state_->policy = options.subscriptionPolicy;
+        if (options.executor) {
+            state_->executor = Strand(options.executor).AsExecutor();
+        }
     }
 
-    connected_ = true;
+    RoomOptions *roomOptions = new RoomOptions;
+    roomOptions->set_auto_subscribe(options.autoSubscribe && !options.subscriptionPolicy);
+    roomOptions->set_adaptive_stream(options.adaptiveStream);
+    roomOptions->set_dynacast(options.dynacast);
 
-    RoomOptions *options = new RoomOptions;
-    options->set_auto_subscribe(true);
-    
     ConnectRequest *connectRequest = new ConnectRequest;
     connectRequest->set_url(url);
     connectRequest->set_token(token);
-    connectRequest->set_allocated_options(options);
+    connectRequest->set_allocated_options(roomOptions);
 
     FFIRequest request;
     request.set_allocated_connect(connectRequest);
-    
-    // TODO Free:
-    FfiClient::getInstance().AddListener(std::bind(&Room::OnEvent, this, std::placeholders::_1));
 
-    FFIResponse response = FfiClient::getInstance().SendRequest(request);
-    FFIAsyncId asyncId = response.connect().async_id();
+    // Not under the state lock, the callback may run before SendAsyncRequest returns
+    std::weak_ptr<State> weak = state_;
+    try {
+        FfiClient::getInstance().SendAsyncRequest(request, [weak, executor = state_->executor,
+                                                            handler = std::move(handler)](const FFIEvent& event) {
+            const ConnectCallback& connectCallback = event.connect();
+            if (std::shared_ptr<State> state = weak.lock()) {
+                state->OnConnect(state, connectCallback);
+            } else if (!connectCallback.has_error()) {
+                // Nobody owns the room anymore, release it
+                FfiHandle orphan(connectCallback.room().handle().id());
+            }
+
+            if (!handler) {
+                return;
+            }
+            if (executor) {
+                executor([handler, connectCallback]() { handler(connectCallback); });
+            } else {
+                handler(connectCallback);
+            }
+        });
+    } catch (...) {
+        // The connect didn't start, the room can be connected again
+        std::lock_guard<std::mutex> guard(state_->lock);
+        state_->connected = false;
+        throw;
+    }
+}
+
+AsyncOperation<ConnectCallback> Room::ConnectAsync(const std::string& url, const std::string& token,
+                                                   Executor executor)
+{
+    return ConnectAsync(url, token, ConnectOptions{}, std::move(executor));
+}
+
+AsyncOperation<ConnectCallback> Room::ConnectAsync(const std::string& url, const std::string& token,
+                                                   const ConnectOptions& options, Executor executor)
+{
+    return AsyncOperation<ConnectCallback>([this, url, token, options](AsyncOperation<ConnectCallback>::Complete complete) {
+        Connect(url, token, options, std::move(complete));
+    }, std::move(executor));
+}
+
+void Room::SetSubscribed(const std::string& participantSid, const std::string& trackSid, bool subscribed)
+{
+    uintptr_t handle;
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        handle = state_->ConnectedHandle();
+    }
+    SendSetSubscribed(handle, participantSid, trackSid, subscribed);
+}
+
+Room::VideoSinkId Room::AddVideoSink(const std::string& trackSid, const VideoSinkSettings& settings)
+{
+    std::unique_lock<std::mutex> guard(state_->lock);
+    state_->ConnectedHandle();
+    VideoSinkId id = state_->videoSinks.Add(trackSid, settings);
+    state_->UpdateTrackSettings(guard, trackSid);
+    return id;
+}
+
+void Room::UpdateVideoSink(VideoSinkId id, const VideoSinkSettings& settings)
+{
+    std::unique_lock<std::mutex> guard(state_->lock);
+    state_->ConnectedHandle();
+    state_->UpdateTrackSettings(guard, state_->videoSinks.Update(id, settings));
+}
+
+void Room::RemoveVideoSink(VideoSinkId id)
+{
+    std::unique_lock<std::mutex> guard(state_->lock);
+    state_->ConnectedHandle();
+    state_->UpdateTrackSettings(guard, state_->videoSinks.Remove(id));
+}
+
+void Room::PublishData(ByteSpan data, DataPacketKind kind, const std::vector<std::string>& destinationSids)
+{
+    uintptr_t handle;
+    DataBatcher *batcher;
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        handle = state_->ConnectedHandle();
+        batcher = state_->dataBatcher.get();
+    }
+
+    if (batcher != nullptr && destinationSids.empty()) {
+        batcher->Publish(data, kind);
+    } else {
+        SendPublishData(handle, data, kind, destinationSids);
+    }
+}
+
+void Room::EnableDataBatching(const DataBatchOptions& options)
+{
+    std::lock_guard<std::mutex> guard(state_->lock);
+    if (state_->dataBatcher) {
+        throw std::runtime_error("data batching already enabled");
+    }
+
+    // Only published once connected. The batcher is owned by the state,
+    // which it can reach directly.
+    State *state = state_.get();
+    state_->dataBatcher = std::make_unique<DataBatcher>(options, [state](ByteSpan data, DataPacketKind kind) {
+        uintptr_t handle;
+        {
+            std::lock_guard<std::mutex> guard(state->lock);
+            handle = state->handle.handle;
+        }
+        SendPublishData(handle, data, kind, {});
+    });
+}
+
+void Room::FlushData()
+{
+    DataBatcher *batcher;
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        batcher = state_->dataBatcher.get();
+    }
+    if (batcher != nullptr) {
+        batcher->Flush();
+    }
+}
 
-    connectAsyncId_ = asyncId.id();
+void Room::SetDataHandler(DataHandler handler)
+{
+    std::shared_ptr<const DataHandler> shared;
+    if (handler) {
+        shared = std::make_shared<const DataHandler>(std::move(handler));
+    }
+    std::atomic_store(&state_->dataHandler, std::move(shared));
 }
 
-void Room::OnEvent(const FFIEvent& event)
+void Room::State::OnConnect(const std::shared_ptr<State>& self, const ConnectCallback& connectCallback)
 {
-    std::lock_guard<std::mutex> guard(lock_);
-    if (!connected_) {
+    if (connectCallback.has_error()) {
+        std::cerr << "Failed to connect to room: " << connectCallback.error() << std::endl;
+        // Can be retried
+        std::lock_guard<std::mutex> guard(lock);
+        connected = false;
         return;
     }
-    
-    if (event.has_connect()) {
-        ConnectCallback connectCallback = event.connect();
-        if (connectCallback.async_id().id() != connectAsyncId_) {
+
+    std::weak_ptr<State> weak = self;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (closed) {
+            // The Room was destroyed while this callback waited for the lock
+            FfiHandle orphan(connectCallback.room().handle().id());
             return;
         }
+        handle.Reset(connectCallback.room().handle().id());
+
+        // The room's events are dispatched after this callback, even when it
+        // beat the response of its request (see FfiClient::CompleteAsync), so
+        // none is missed. Unless the event queue has several dispatcher
+        // threads without pinning: events that overtake it are lost.
+        cache.Reset(connectCallback.room());
+        listenerId = FfiClient::getInstance().AddListener(
+            EventSubscription::ForRoom(connectCallback.room().sid()),
+            [weak, executor = executor](const FFIEvent& event) {
+                if (!executor) {
+                    DeliverRoomEvent(weak, event.room_event());
+                    return;
+                }
+                // The event is only valid for this call
+                auto roomEvent = std::make_shared<const RoomEvent>(event.room_event());
+                executor([weak, roomEvent]() { DeliverRoomEvent(weak, *roomEvent); });
+            });
+    }
+
+    // Not under the lock, the policy may call back into the Room
+    if (policy && executor) {
+        executor([weak]() {
+            if (std::shared_ptr<State> state = weak.lock()) {
+                state->ApplyPolicyToCache();
+            }
+        });
+    } else if (policy) {
+        ApplyPolicyToCache();
+    }
+}
+
+void Room::State::DeliverRoomEvent(const std::weak_ptr<State>& weak, const RoomEvent& event)
+{
+    if (std::shared_ptr<State> state = weak.lock()) {
+        state->OnRoomEvent(event);
+    } else if (event.has_data_received()) {
+        FfiHandle orphan(event.data_received().handle().id());
+    }
+}
+
+// Called without the lock, GetParticipants returns a copy
+void Room::State::ApplyPolicyToCache()
+{
+    for (const Participant& participant : cache.GetParticipants()) {
+        for (const TrackPublication& publication : participant.publications) {
+            ApplyPolicy(participant, publication);
+        }
+    }
+}
 
-        std::cout << "Received ConnectCallback" << std::endl;
+void Room::State::OnRoomEvent(const RoomEvent& event)
+{
+    cache.Apply(event);
 
-        if (!connectCallback.has_error()) {
-            handle_ = FfiHandle(connectCallback.room().handle().id());
+    switch (event.message_case()) {
+        case RoomEvent::kParticipantConnected: {
+            if (!policy) {
+                break;
+            }
+            Participant participant = Participant::FromInfo(event.participant_connected().info());
+            for (const TrackPublication& publication : participant.publications) {
+                ApplyPolicy(participant, publication);
+            }
+            break;
+        }
+        case RoomEvent::kTrackPublished: {
+            if (!policy) {
+                break;
+            }
+            const TrackPublished& published = event.track_published();
+            if (std::optional<Participant> participant = cache.GetParticipant(published.participant_sid())) {
+                ApplyPolicy(*participant, TrackPublication::FromInfo(published.publication()));
+            }
+            break;
+        }
+        case RoomEvent::kDataReceived:
+            OnDataReceived(event.data_received());
+            break;
+        default:
+            break;
+    }
+}
+
+void Room::State::OnDataReceived(const DataReceived& received)
+{
+    // Owns the buffer the packets point into, released with the last of them
+    auto buffer = std::make_shared<const FfiHandle>(received.handle().id());
+    std::shared_ptr<const DataHandler> handler = std::atomic_load(&dataHandler);
+    if (!handler) {
+        return;
+    }
+
+    ByteSpan data(reinterpret_cast<const uint8_t *>(received.data_ptr()), received.data_size());
+    std::vector<ByteSpan> packets;
+    if (!DataBatcher::Split(data, packets)) {
+        (*handler)(DataPacket(std::move(buffer), data, received.participant_sid(), received.kind()));
+        return;
+    }
+    for (ByteSpan packet : packets) {
+        (*handler)(DataPacket(buffer, packet, received.participant_sid(), received.kind()));
+    }
+}
+
+// Called with the lock held
+uintptr_t Room::State::ConnectedHandle()
+{
+    if (handle.handle == INVALID_HANDLE) {
+        throw std::runtime_error("not connected");
+    }
+    return handle.handle;
+}
+
+// Called with the lock held, which is released while sending. One thread at
+// a time sends the requests of a track: a change made meanwhile is left to
+// it, and it resolves the track again once its request went out, so the
+// last request sent is always the latest settings.
+void Room::State::UpdateTrackSettings(std::unique_lock<std::mutex>& guard, const std::string& trackSid)
+{
+    if (trackSid.empty() || !videoSinks.BeginSend(trackSid)) {
+        return;
+    }
+
+    while (true) {
+        uint64_t generation = videoSinks.GetGeneration(trackSid);
+        std::optional<TrackPublication> publication = cache.GetTrackPublication(trackSid);
+        std::optional<TrackSettings> settings = videoSinks.Resolve(
+            trackSid, publication ? publication->width : 0, publication ? publication->height : 0);
+        if (!settings) {
+            videoSinks.EndSend(trackSid);
+            return;
+        }
+
+        UpdateTrackSettingsRequest *update = new UpdateTrackSettingsRequest;
+        update->mutable_room_handle()->set_id(handle.handle);
+        update->set_track_sid(trackSid);
+        update->set_disabled(settings->disabled);
+        update->set_width(settings->width);
+        update->set_height(settings->height);
+        update->set_quality(settings->quality);
+        update->set_fps(settings->fps);
+
+        FFIRequest request;
+        request.set_allocated_update_track_settings(update);
+        guard.unlock();
+        try {
+            FfiClient::getInstance().SendRequest(request);
+        } catch (...) {
+            guard.lock();
+            videoSinks.EndSend(trackSid);
+            throw;
+        }
+        guard.lock();
+        if (videoSinks.MarkSent(trackSid, *settings, generation)) {
+            return;
+        }
+    }
+}
+
+void Room::State::ApplyPolicy(const Participant& participant, const TrackPublication& publication)
+{
+    if (publication.subscribed || !policy(participant, publication)) {
+        return;
+    }
+
+    uintptr_t roomHandle;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        roomHandle = handle.handle;
+    }
+    // Runs from the event path, never throw back into the Rust runtime
+    try {
+        SendSetSubscribed(roomHandle, participant.sid, publication.sid, true);
+    } catch (const std::exception& e) {
+        std::cerr << "failed to subscribe to " << publication.sid << ": " << e.what() << std::endl;
+    }
+}
+
+uintptr_t Room::GetHandle() const
+{
+    std::lock_guard<std::mutex> guard(state_->lock);
+    return state_->handle.handle;
+}
+
+std::string Room::GetSid() const
+{
+    return state_->cache.GetSid();
+}
+
+std::string Room::GetName() const
+{
+    return state_->cache.GetName();
+}
+
+std::string Room::GetMetadata() const
+{
+    return state_->cache.GetMetadata();
+}
+
+Participant Room::GetLocalParticipant() const
+{
+    return state_->cache.GetLocalParticipant();
+}
+
+std::optional<Participant> Room::GetParticipant(const std::string& sid) const
+{
+    return state_->cache.GetParticipant(sid);
+}
+
+std::optional<Participant> Room::GetParticipantByIdentity(const std::string& identity) const
+{
+    return state_->cache.GetParticipantByIdentity(identity);
+}
+
+std::optional<TrackPublication> Room::GetTrackPublication(const std::string& trackSid) const
+{
+    return state_->cache.GetTrackPublication(trackSid);
+}
+
+std::vector<Participant> Room::GetParticipants() const
+{
+    return state_->cache.GetParticipants();
+}
+
+size_t Room::GetParticipantCount() const
+{
+    return state_->cache.GetParticipantCount();
+}
+
+namespace
+{
+
+// Shared with the connect handlers, which may run after ConnectRooms timed out
+struct BulkConnect {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::vector<ConnectCallback> callbacks;
+    std::vector<bool> done;
+    size_t remaining = 0;
+    size_t inFlight = 0;
+    // onConnected calls in progress
+    size_t notifying = 0;
+    bool finished = false;
+    std::function<void(size_t index, const ConnectCallback&)> onConnected;
+
+    void Complete(size_t index, const ConnectCallback& callback)
+    {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            if (finished || done[index]) {
+                return;
+            }
+            callbacks[index] = callback;
+            done[index] = true;
+            --remaining;
+            --inFlight;
+            if (onConnected) {
+                ++notifying;
+            }
+        }
+        changed.notify_all();
+        if (!onConnected) {
+            return;
+        }
+
+        onConnected(index, callback);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            --notifying;
+        }
+        changed.notify_all();
+    }
+};
+
+ConnectCallback ConnectError(const std::string& error)
+{
+    ConnectCallback callback;
+    callback.set_error(error);
+    return callback;
+}
+
+}
+
+BulkConnectResult ConnectRooms(const std::vector<RoomConnection>& rooms, const BulkConnectOptions& options)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto bulk = std::make_shared<BulkConnect>();
+    bulk->callbacks.resize(rooms.size());
+    bulk->done.resize(rooms.size(), false);
+    bulk->remaining = rooms.size();
+    bulk->onConnected = options.onConnected;
+
+    // Each issuer takes the next room once there is room in the window
+    std::atomic<size_t> next{0};
+    auto issue = [&rooms, &options, &next, bulk]() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> guard(bulk->lock);
+                bulk->changed.wait(guard, [&]() {
+                    return bulk->finished || options.maxInFlight == 0 || bulk->inFlight < options.maxInFlight;
+                });
+                if (bulk->finished) {
+                    return;
+                }
+                ++bulk->inFlight;
+            }
+            size_t index = next.fetch_add(1);
+            if (index >= rooms.size()) {
+                std::lock_guard<std::mutex> guard(bulk->lock);
+                --bulk->inFlight;
+                return;
+            }
+
+            const RoomConnection& connection = rooms[index];
+            try {
+                connection.room->Connect(connection.url, connection.token, connection.options,
+                                         [bulk, index](const ConnectCallback& callback) {
+                                             bulk->Complete(index, callback);
+                                         });
+            } catch (const std::exception& e) {
+                bulk->Complete(index, ConnectError(e.what()));
+            }
+        }
+    };
+
+    std::vector<std::thread> issuers;
+    size_t threads = std::min(std::max<size_t>(options.threads, 1), std::max<size_t>(rooms.size(), 1));
+    for (size_t i = 0; i < threads; ++i) {
+        issuers.emplace_back(issue);
+    }
+
+    BulkConnectResult result;
+    {
+        std::unique_lock<std::mutex> guard(bulk->lock);
+        auto connected = [&]() { return bulk->remaining == 0; };
+        if (options.timeout == std::chrono::milliseconds::max()) {
+            bulk->changed.wait(guard, connected);
+        } else {
+            bulk->changed.wait_for(guard, options.timeout, connected);
+        }
+        bulk->finished = true;
+        for (size_t i = 0; i < rooms.size(); ++i) {
+            if (!bulk->done[i]) {
+                bulk->callbacks[i] = ConnectError("timed out");
+            }
+        }
+    }
+    bulk->changed.notify_all();
+    for (std::thread& issuer : issuers) {
+        issuer.join();
+    }
 
-            std::cout << "Connected to room" << std::endl;
-            std::cout << "Room SID: " << connectCallback.room().sid() << std::endl;
+    std::unique_lock<std::mutex> guard(bulk->lock);
+    bulk->changed.wait(guard, [&]() { return bulk->notifying == 0; });
+    result.callbacks = std::move(bulk->callbacks);
+    for (const ConnectCallback& callback : result.callbacks) {
+        if (callback.has_error()) {
+            ++result.failed;
         } else {
-            std::cerr << "Failed to connect to room: " << connectCallback.error() << std::endl;
+            ++result.connected;
         }
     }
+    result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    return result;
 }
 
 }
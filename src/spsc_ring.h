@@ -0,0 +1,114 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_SPSC_RING_H
+#define LIVEKIT_SPSC_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+namespace livekit
+{
+    // Wait-free single producer / single consumer ring of trivially copyable
+    // items. Neither side ever blocks or allocates, which makes the producer
+    // side safe to call from real-time audio threads.
+    template<typename T>
+    class SpscRing
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "SpscRing items are copied with memcpy");
+
+    public:
+        explicit SpscRing(size_t capacity) : capacity_(RoundUp(capacity)), items_(new T[capacity_]) {}
+
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        // Producer side, returns how many items fit
+        size_t Write(const T *items, size_t count) {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            if (capacity_ - (tail - cachedHead_) < count) {
+                cachedHead_ = head_.load(std::memory_order_acquire);
+            }
+            count = std::min(count, capacity_ - (tail - cachedHead_));
+            Copy(items_.get(), tail, items, count);
+            tail_.store(tail + count, std::memory_order_release);
+            return count;
+        }
+
+        // Producer side, room left for Write
+        size_t Space() {
+            size_t tail = tail_.load(std::memory_order_relaxed);
+            cachedHead_ = head_.load(std::memory_order_acquire);
+            return capacity_ - (tail - cachedHead_);
+        }
+
+        // Consumer side, returns how many items were read
+        size_t Read(T *items, size_t count) {
+            size_t head = head_.load(std::memory_order_relaxed);
+            if (cachedTail_ - head < count) {
+                cachedTail_ = tail_.load(std::memory_order_acquire);
+            }
+            count = std::min(count, cachedTail_ - head);
+            CopyOut(items, head, count);
+            head_.store(head + count, std::memory_order_release);
+            return count;
+        }
+
+        // Consumer side
+        size_t Available() const {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_relaxed);
+        }
+
+        size_t Capacity() const { return capacity_; }
+
+    private:
+        static size_t RoundUp(size_t capacity) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        void Copy(T *ring, size_t position, const T *items, size_t count) {
+            size_t offset = position & (capacity_ - 1);
+            size_t first = std::min(count, capacity_ - offset);
+            std::memcpy(ring + offset, items, first * sizeof(T));
+            std::memcpy(ring, items + first, (count - first) * sizeof(T));
+        }
+
+        void CopyOut(T *items, size_t position, size_t count) const {
+            size_t offset = position & (capacity_ - 1);
+            size_t first = std::min(count, capacity_ - offset);
+            std::memcpy(items, items_.get() + offset, first * sizeof(T));
+            std::memcpy(items + first, items_.get(), (count - first) * sizeof(T));
+        }
+
+        const size_t capacity_;
+        std::unique_ptr<T[]> items_;
+
+        // Positions only grow, wrapping is handled by the unsigned arithmetic
+        alignas(64) std::atomic<size_t> head_{0};
+        size_t cachedTail_{0};
+        alignas(64) std::atomic<size_t> tail_{0};
+        size_t cachedHead_{0};
+    };
+}
+
+#endif /* LIVEKIT_SPSC_RING_H */
@@ -0,0 +1,249 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "tracer.h"
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+constexpr size_t kMaxOneofCases = 64;
+
+template<typename Message>
+std::array<const char *, kMaxOneofCases> OneofNames() {
+    std::array<const char *, kMaxOneofCases> names;
+    names.fill("unknown");
+    const google::protobuf::OneofDescriptor *oneof = Message::descriptor()->FindOneofByName("message");
+    for (int i = 0; oneof != nullptr && i < oneof->field_count(); ++i) {
+        const google::protobuf::FieldDescriptor *field = oneof->field(i);
+        if (field->number() > 0 && static_cast<size_t>(field->number()) < kMaxOneofCases) {
+            names[field->number()] = field->name().c_str();
+        }
+    }
+    return names;
+}
+
+const char *OneofName(const std::array<const char *, kMaxOneofCases>& names, int type) {
+    return type > 0 && static_cast<size_t>(type) < kMaxOneofCases ? names[type] : "unknown";
+}
+
+#if defined(LIVEKIT_TRACING)
+
+struct TraceEvent {
+    const char *category;
+    const char *name;
+    char phase;
+    uint64_t timestamp;
+    uint64_t duration;
+    uint64_t id;
+    const char *argName;
+    uint64_t argValue;
+};
+
+// Only contended while the trace is written out
+struct ThreadBuffer {
+    std::mutex lock;
+    uint32_t tid;
+    std::vector<TraceEvent> events;
+    uint64_t dropped = 0;
+    bool exited = false;    // under Registry::lock
+};
+
+struct Registry {
+    std::mutex lock;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    uint32_t nextTid = 1;
+    uint64_t epoch = 0;
+};
+
+// Leaked: threads may still record while static objects are destroyed
+Registry& GetRegistry() {
+    static Registry *registry = new Registry();
+    return *registry;
+}
+
+struct BufferLease {
+    ThreadBuffer *buffer = nullptr;
+
+    ~BufferLease() {
+        if (buffer != nullptr) {
+            std::lock_guard<std::mutex> guard(GetRegistry().lock);
+            buffer->exited = true;
+        }
+    }
+};
+
+ThreadBuffer& LocalBuffer() {
+    thread_local BufferLease lease;
+    if (lease.buffer == nullptr) {
+        Registry& registry = GetRegistry();
+        std::lock_guard<std::mutex> guard(registry.lock);
+        registry.buffers.push_back(std::make_unique<ThreadBuffer>());
+        lease.buffer = registry.buffers.back().get();
+        lease.buffer->tid = registry.nextTid++;
+    }
+    return *lease.buffer;
+}
+
+// Read without the registry lock, only changes while tracing is stopped
+std::atomic<size_t> maxEvents{0};
+
+void Append(const TraceEvent& event) {
+    ThreadBuffer& buffer = LocalBuffer();
+    std::lock_guard<std::mutex> guard(buffer.lock);
+    if (buffer.events.size() < maxEvents.load(std::memory_order_relaxed)) {
+        buffer.events.push_back(event);
+    } else {
+        buffer.dropped++;
+    }
+}
+
+// Chrome trace timestamps are in microseconds
+void WriteTime(std::FILE *file, const char *key, uint64_t ns) {
+    std::fprintf(file, ",\"%s\":%llu.%03llu", key,
+                 static_cast<unsigned long long>(ns / 1000), static_cast<unsigned long long>(ns % 1000));
+}
+
+void WriteEvent(std::FILE *file, const TraceEvent& event, uint32_t tid, uint64_t epoch, bool first) {
+    std::fprintf(file, "%s\n{\"ph\":\"%c\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":1,\"tid\":%u",
+                 first ? "" : ",", event.phase, event.category, event.name, tid);
+    WriteTime(file, "ts", event.timestamp > epoch ? event.timestamp - epoch : 0);
+    if (event.phase == 'X') {
+        WriteTime(file, "dur", event.duration);
+    } else {
+        std::fprintf(file, ",\"id\":\"0x%llx\"", static_cast<unsigned long long>(event.id));
+    }
+    if (event.argName != nullptr) {
+        std::fprintf(file, ",\"args\":{\"%s\":%llu}", event.argName, static_cast<unsigned long long>(event.argValue));
+    }
+    std::fputc('}', file);
+}
+
+#endif
+
+}
+
+std::atomic<bool> Tracer::active_{false};
+
+uint64_t Tracer::Now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+const char *Tracer::RequestName(int type) {
+    static const std::array<const char *, kMaxOneofCases> names = OneofNames<FFIRequest>();
+    return OneofName(names, type);
+}
+
+const char *Tracer::EventName(int type) {
+    static const std::array<const char *, kMaxOneofCases> names = OneofNames<FFIEvent>();
+    return OneofName(names, type);
+}
+
+#if defined(LIVEKIT_TRACING)
+
+bool Tracer::Start(size_t maxEventsPerThread) {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    for (std::unique_ptr<ThreadBuffer>& buffer : registry.buffers) {
+        std::lock_guard<std::mutex> bufferGuard(buffer->lock);
+        buffer->events.clear();
+        buffer->dropped = 0;
+    }
+    registry.epoch = Now();
+    maxEvents.store(maxEventsPerThread, std::memory_order_relaxed);
+    active_.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+bool Tracer::Stop(const std::string& path) {
+    active_.store(false, std::memory_order_relaxed);
+
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> guard(registry.lock);
+    std::FILE *file = std::fopen(path.c_str(), "w");
+    if (file != nullptr) {
+        std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+    }
+
+    bool first = true;
+    uint64_t dropped = 0;
+    for (auto it = registry.buffers.begin(); it != registry.buffers.end();) {
+        ThreadBuffer& buffer = **it;
+        {
+            std::lock_guard<std::mutex> bufferGuard(buffer.lock);
+            for (size_t i = 0; file != nullptr && i < buffer.events.size(); ++i) {
+                WriteEvent(file, buffer.events[i], buffer.tid, registry.epoch, first);
+                first = false;
+            }
+            dropped += buffer.dropped;
+            buffer.events.clear();
+            buffer.events.shrink_to_fit();
+            buffer.dropped = 0;
+        }
+        // Buffers of the threads that are gone aren't needed anymore
+        it = buffer.exited ? registry.buffers.erase(it) : it + 1;
+    }
+
+    if (file == nullptr) {
+        return false;
+    }
+    std::fprintf(file, "\n],\"otherData\":{\"dropped\":\"%llu\"}}\n", static_cast<unsigned long long>(dropped));
+    return std::fclose(file) == 0;
+}
+
+void Tracer::Complete(const char *category, const char *name, uint64_t startNs,
+                      const char *argName, uint64_t argValue) {
+    uint64_t end = Now();
+    Append(TraceEvent{category, name, 'X', startNs, end - startNs, 0, argName, argValue});
+}
+
+void Tracer::AsyncBegin(const char *category, const char *name, uint64_t id) {
+    Append(TraceEvent{category, name, 'b', Now(), 0, id, nullptr, 0});
+}
+
+void Tracer::AsyncEnd(const char *category, const char *name, uint64_t id) {
+    Append(TraceEvent{category, name, 'e', Now(), 0, id, nullptr, 0});
+}
+
+#else
+
+bool Tracer::Start(size_t) {
+    return false;
+}
+
+bool Tracer::Stop(const std::string&) {
+    return false;
+}
+
+void Tracer::Complete(const char *, const char *, uint64_t, const char *, uint64_t) {}
+void Tracer::AsyncBegin(const char *, const char *, uint64_t) {}
+void Tracer::AsyncEnd(const char *, const char *, uint64_t) {}
+
+#endif
+
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_TRACER_H
+#define LIVEKIT_TRACER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace livekit
+{
+    // Trace spans behind FfiClient::StartTracing, written out in the Chrome
+    // trace event format. Recording sites use the LIVEKIT_TRACE_* macros,
+    // which compile to nothing unless built with LIVEKIT_TRACING; when built
+    // in but not started, a span costs a relaxed load.
+    //
+    // Names and categories must outlive the trace (string literals or
+    // descriptor names).
+    class Tracer
+    {
+    public:
+        static bool Active() { return active_.load(std::memory_order_relaxed); }
+
+        static bool Start(size_t maxEventsPerThread);
+        static bool Stop(const std::string& path);
+
+        static uint64_t Now();
+
+        static void Complete(const char *category, const char *name, uint64_t startNs,
+                             const char *argName, uint64_t argValue);
+        // Async spans sharing an id are drawn on the same track
+        static void AsyncBegin(const char *category, const char *name, uint64_t id);
+        static void AsyncEnd(const char *category, const char *name, uint64_t id);
+
+        // Oneof field names, e.g. "connect"
+        static const char *RequestName(int type);
+        static const char *EventName(int type);
+
+    private:
+        static std::atomic<bool> active_;
+    };
+
+    class TraceScope
+    {
+    public:
+        TraceScope(const char *category, const char *name, const char *argName = nullptr, uint64_t argValue = 0)
+            : category_(category), name_(name), argName_(argName), argValue_(argValue),
+              start_(Tracer::Active() ? Tracer::Now() : 0) {}
+
+        ~TraceScope() {
+            if (start_ != 0) {
+                Tracer::Complete(category_, name_, start_, argName_, argValue_);
+            }
+        }
+
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+
+    private:
+        const char *category_;
+        const char *name_;
+        const char *argName_;
+        uint64_t argValue_;
+        uint64_t start_;
+    };
+}
+
+#if defined(LIVEKIT_TRACING)
+#define LIVEKIT_TRACE_CONCAT_(a, b) a##b
+#define LIVEKIT_TRACE_CONCAT(a, b) LIVEKIT_TRACE_CONCAT_(a, b)
+#define LIVEKIT_TRACE_SCOPE(...) ::livekit::TraceScope LIVEKIT_TRACE_CONCAT(traceScope, __LINE__)(__VA_ARGS__)
+#define LIVEKIT_TRACE_ASYNC_BEGIN(category, name, id)         \
+    do {                                                      \
+        if (::livekit::Tracer::Active()) {                    \
+            ::livekit::Tracer::AsyncBegin(category, name, id); \
+        }                                                     \
+    } while (0)
+#define LIVEKIT_TRACE_ASYNC_END(category, name, id)         \
+    do {                                                    \
+        if (::livekit::Tracer::Active()) {                  \
+            ::livekit::Tracer::AsyncEnd(category, name, id); \
+        }                                                   \
+    } while (0)
+#else
+#define LIVEKIT_TRACE_SCOPE(...) ((void)0)
+#define LIVEKIT_TRACE_ASYNC_BEGIN(category, name, id) ((void)0)
+#define LIVEKIT_TRACE_ASYNC_END(category, name, id) ((void)0)
+#endif
+
+#endif /* LIVEKIT_TRACER_H */
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/video_buffer_allocator.h"
+
+#include <new>
+#include <stdexcept>
+
+namespace livekit
+{
+
+namespace
+{
+
+size_t AlignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}
+
+std::unique_ptr<VideoFrameBuffer> FfiVideoBufferAllocator::Allocate(VideoFrameBufferType type, uint32_t width, uint32_t height) {
+    return VideoFrameBuffer::Allocate(type, width, height);
+}
+
+HostVideoBufferAllocator::HostVideoBufferAllocator(size_t alignment)
+    : HostVideoBufferAllocator(
+          [alignment](size_t size) -> void * { return ::operator new(size, std::align_val_t(alignment), std::nothrow); },
+          [alignment](void *ptr) { ::operator delete(ptr, std::align_val_t(alignment)); },
+          alignment) {}
+
+HostVideoBufferAllocator::HostVideoBufferAllocator(AllocFn alloc, FreeFn free, size_t alignment)
+    : alloc_(std::move(alloc)), free_(std::move(free)), alignment_(alignment) {
+    if (!alloc_ || !free_) {
+        throw std::invalid_argument("a host allocator needs alloc and free functions");
+    }
+    if (alignment_ == 0 || (alignment_ & (alignment_ - 1)) != 0) {
+        throw std::invalid_argument("the alignment must be a power of two");
+    }
+}
+
+std::unique_ptr<VideoFrameBuffer> HostVideoBufferAllocator::Allocate(VideoFrameBufferType type, uint32_t width, uint32_t height) {
+    const uint32_t halfWidth = (width + 1) / 2;
+    const uint32_t halfHeight = (height + 1) / 2;
+
+    // The same layout as the FFI buffers, widths in samples
+    VideoPlane planes[4]{};
+    size_t numPlanes = 3;
+    size_t bytesPerSample = 1;
+    switch (type) {
+        case VideoFrameBufferType::I420:
+        case VideoFrameBufferType::I420A:
+            planes[0] = {nullptr, 0, width, height};
+            planes[1] = planes[2] = {nullptr, 0, halfWidth, halfHeight};
+            if (type == VideoFrameBufferType::I420A) {
+                planes[3] = {nullptr, 0, width, height};
+                numPlanes = 4;
+            }
+            break;
+        case VideoFrameBufferType::I010:
+            planes[0] = {nullptr, 0, width, height};
+            planes[1] = planes[2] = {nullptr, 0, halfWidth, halfHeight};
+            bytesPerSample = 2;
+            break;
+        case VideoFrameBufferType::I422:
+            planes[0] = {nullptr, 0, width, height};
+            planes[1] = planes[2] = {nullptr, 0, halfWidth, height};
+            break;
+        case VideoFrameBufferType::I444:
+            planes[0] = planes[1] = planes[2] = {nullptr, 0, width, height};
+            break;
+        case VideoFrameBufferType::NV12:
+            planes[0] = {nullptr, 0, width, height};
+            planes[1] = {nullptr, 0, halfWidth * 2, halfHeight};
+            numPlanes = 2;
+            break;
+        default:
+            throw std::invalid_argument("only the FFI can allocate native buffers");
+    }
+
+    size_t offsets[4]{};
+    size_t size = 0;
+    for (size_t i = 0; i < numPlanes; ++i) {
+        planes[i].stride = static_cast<uint32_t>(AlignUp(planes[i].width * bytesPerSample, alignment_));
+        offsets[i] = size;
+        size += AlignUp(static_cast<size_t>(planes[i].stride) * planes[i].height, alignment_);
+    }
+
+    uint8_t *data = static_cast<uint8_t *>(alloc_(size));
+    if (!data) {
+        throw std::bad_alloc();
+    }
+    std::shared_ptr<void> memory(data, free_);
+    for (size_t i = 0; i < numPlanes; ++i) {
+        planes[i].data = data + offsets[i];
+    }
+    return std::make_unique<VideoFrameBuffer>(type, width, height, planes, numPlanes, std::move(memory));
+}
+
+}
@@ -0,0 +1,557 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/video_convert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "cpu_features.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+// Fixed-point BT.601 coefficients. The SIMD kernels work on int16 lanes and
+// saturate the intermediate sums; that only happens for values clamped to 0
+// or 255 anyway, so every implementation produces the same output.
+constexpr int kYToRGB = 74;     // 1.164 * 64
+constexpr int kVToR = 102;      // 1.596 * 64
+constexpr int kUToG = 25;       // 0.391 * 64
+constexpr int kVToG = 52;       // 0.813 * 64
+constexpr int kUToB = 129;      // 2.018 * 64
+
+// RGB to YUV, same coefficients as libyuv
+constexpr int kBToY = 13, kGToY = 65, kRToY = 33;       // 7 fractional bits
+constexpr int kBToU = 112, kGToU = -74, kRToU = -38;    // 8 fractional bits
+constexpr int kBToV = -18, kGToV = -94, kRToV = 112;
+
+using I420ToRGBARowFn = void (*)(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width);
+using SplitUVRowFn = void (*)(const uint8_t *uv, uint8_t *u, uint8_t *v, int width);
+using ARGBToYRowFn = void (*)(const uint8_t *src, uint8_t *y, int width);
+using ARGBToUVRowFn = void (*)(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, int width);
+
+inline uint8_t Clamp255(int value) {
+    return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+
+inline int Avg(int a, int b) {
+    return (a + b + 1) >> 1;
+}
+
+// Scalar kernels, also used for the tail of the SIMD rows
+
+void I420ToRGBARow_C(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width) {
+    for (int x = 0; x < width; ++x) {
+        int y1 = (y[x] - 16) * kYToRGB;
+        int u1 = u[x / 2] - 128;
+        int v1 = v[x / 2] - 128;
+        dst[4 * x + 0] = Clamp255((y1 + kVToR * v1 + 32) >> 6);
+        dst[4 * x + 1] = Clamp255((y1 - kUToG * u1 - kVToG * v1 + 32) >> 6);
+        dst[4 * x + 2] = Clamp255((y1 + kUToB * u1 + 32) >> 6);
+        dst[4 * x + 3] = 255;
+    }
+}
+
+void SplitUVRow_C(const uint8_t *uv, uint8_t *u, uint8_t *v, int width) {
+    for (int x = 0; x < width; ++x) {
+        u[x] = uv[2 * x];
+        v[x] = uv[2 * x + 1];
+    }
+}
+
+void ARGBToYRow_C(const uint8_t *src, uint8_t *y, int width) {
+    for (int x = 0; x < width; ++x) {
+        const uint8_t *p = src + 4 * x;
+        y[x] = static_cast<uint8_t>(((kBToY * p[0] + kGToY * p[1] + kRToY * p[2] + 64) >> 7) + 16);
+    }
+}
+
+// Averages rows first, then neighbour pixels, like the SIMD kernels do
+void ARGBToUVRow_C(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, int width) {
+    for (int x = 0; x < width; x += 2) {
+        const uint8_t *a0 = src0 + 4 * x, *a1 = src1 + 4 * x;
+        const uint8_t *b0 = x + 1 < width ? a0 + 4 : a0, *b1 = x + 1 < width ? a1 + 4 : a1;
+        int b = Avg(Avg(a0[0], a1[0]), Avg(b0[0], b1[0]));
+        int g = Avg(Avg(a0[1], a1[1]), Avg(b0[1], b1[1]));
+        int r = Avg(Avg(a0[2], a1[2]), Avg(b0[2], b1[2]));
+        u[x / 2] = Clamp255(((kBToU * b + kGToU * g + kRToU * r + 128) >> 8) + 128);
+        v[x / 2] = Clamp255(((kBToV * b + kGToV * g + kRToV * r + 128) >> 8) + 128);
+    }
+}
+
+#if defined(LIVEKIT_X86)
+
+LIVEKIT_TARGET("sse2")
+void I420ToRGBARow_SSE2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi8(-1);
+    const __m128i k16 = _mm_set1_epi16(16), k128 = _mm_set1_epi16(128), k32 = _mm_set1_epi16(32);
+    const __m128i yToRGB = _mm_set1_epi16(kYToRGB), vToR = _mm_set1_epi16(kVToR), uToG = _mm_set1_epi16(kUToG);
+    const __m128i vToG = _mm_set1_epi16(kVToG), uToB = _mm_set1_epi16(kUToB);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(y + x));
+        __m128i u8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + x / 2));
+        __m128i v8 = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + x / 2));
+        u8 = _mm_unpacklo_epi8(u8, u8);
+        v8 = _mm_unpacklo_epi8(v8, v8);
+
+        __m128i r[2], g[2], b[2];
+        for (int half = 0; half < 2; ++half) {
+            __m128i yy = half ? _mm_unpackhi_epi8(y8, zero) : _mm_unpacklo_epi8(y8, zero);
+            __m128i uu = half ? _mm_unpackhi_epi8(u8, zero) : _mm_unpacklo_epi8(u8, zero);
+            __m128i vv = half ? _mm_unpackhi_epi8(v8, zero) : _mm_unpacklo_epi8(v8, zero);
+            yy = _mm_mullo_epi16(_mm_sub_epi16(yy, k16), yToRGB);
+            uu = _mm_sub_epi16(uu, k128);
+            vv = _mm_sub_epi16(vv, k128);
+
+            r[half] = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(vv, vToR)), k32), 6);
+            g[half] = _mm_srai_epi16(_mm_adds_epi16(_mm_subs_epi16(_mm_subs_epi16(yy, _mm_mullo_epi16(uu, uToG)),
+                                                                   _mm_mullo_epi16(vv, vToG)), k32), 6);
+            b[half] = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(yy, _mm_mullo_epi16(uu, uToB)), k32), 6);
+        }
+
+        __m128i r8 = _mm_packus_epi16(r[0], r[1]);
+        __m128i g8 = _mm_packus_epi16(g[0], g[1]);
+        __m128i b8 = _mm_packus_epi16(b[0], b[1]);
+        __m128i rgLo = _mm_unpacklo_epi8(r8, g8), rgHi = _mm_unpackhi_epi8(r8, g8);
+        __m128i baLo = _mm_unpacklo_epi8(b8, alpha), baHi = _mm_unpackhi_epi8(b8, alpha);
+
+        __m128i *out = reinterpret_cast<__m128i *>(dst + 4 * x);
+        _mm_storeu_si128(out + 0, _mm_unpacklo_epi16(rgLo, baLo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLo, baLo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHi, baHi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHi, baHi));
+    }
+    I420ToRGBARow_C(y + x, u + x / 2, v + x / 2, dst + 4 * x, width - x);
+}
+
+LIVEKIT_TARGET("avx2")
+void I420ToRGBARow_AVX2(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width) {
+    const __m256i alpha = _mm256_set1_epi8(-1);
+    const __m256i k16 = _mm256_set1_epi16(16), k128 = _mm256_set1_epi16(128), k32 = _mm256_set1_epi16(32);
+    const __m256i yToRGB = _mm256_set1_epi16(kYToRGB), vToR = _mm256_set1_epi16(kVToR);
+    const __m256i uToG = _mm256_set1_epi16(kUToG), vToG = _mm256_set1_epi16(kVToG), uToB = _mm256_set1_epi16(kUToB);
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i y8 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(y + x));
+        __m128i u8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(u + x / 2));
+        __m128i v8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(v + x / 2));
+
+        __m256i r[2], g[2], b[2];
+        for (int half = 0; half < 2; ++half) {
+            __m256i yy = _mm256_cvtepu8_epi16(half ? _mm256_extracti128_si256(y8, 1) : _mm256_castsi256_si128(y8));
+            __m256i uu = _mm256_cvtepu8_epi16(half ? _mm_unpackhi_epi8(u8, u8) : _mm_unpacklo_epi8(u8, u8));
+            __m256i vv = _mm256_cvtepu8_epi16(half ? _mm_unpackhi_epi8(v8, v8) : _mm_unpacklo_epi8(v8, v8));
+            yy = _mm256_mullo_epi16(_mm256_sub_epi16(yy, k16), yToRGB);
+            uu = _mm256_sub_epi16(uu, k128);
+            vv = _mm256_sub_epi16(vv, k128);
+
+            r[half] = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(yy, _mm256_mullo_epi16(vv, vToR)), k32), 6);
+            g[half] = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_subs_epi16(_mm256_subs_epi16(yy, _mm256_mullo_epi16(uu, uToG)),
+                                                                            _mm256_mullo_epi16(vv, vToG)), k32), 6);
+            b[half] = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(yy, _mm256_mullo_epi16(uu, uToB)), k32), 6);
+        }
+
+        // packus works per 128 bits lane, restore the pixel order
+        __m256i r8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(r[0], r[1]), 0xD8);
+        __m256i g8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(g[0], g[1]), 0xD8);
+        __m256i b8 = _mm256_permute4x64_epi64(_mm256_packus_epi16(b[0], b[1]), 0xD8);
+        __m256i rgLo = _mm256_unpacklo_epi8(r8, g8), rgHi = _mm256_unpackhi_epi8(r8, g8);
+        __m256i baLo = _mm256_unpacklo_epi8(b8, alpha), baHi = _mm256_unpackhi_epi8(b8, alpha);
+        __m256i p0 = _mm256_unpacklo_epi16(rgLo, baLo);     // 0-3, 16-19
+        __m256i p1 = _mm256_unpackhi_epi16(rgLo, baLo);     // 4-7, 20-23
+        __m256i p2 = _mm256_unpacklo_epi16(rgHi, baHi);     // 8-11, 24-27
+        __m256i p3 = _mm256_unpackhi_epi16(rgHi, baHi);     // 12-15, 28-31
+
+        __m256i *out = reinterpret_cast<__m256i *>(dst + 4 * x);
+        _mm256_storeu_si256(out + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(out + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(out + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(out + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    _mm256_zeroupper();
+    I420ToRGBARow_SSE2(y + x, u + x / 2, v + x / 2, dst + 4 * x, width - x);
+}
+
+LIVEKIT_TARGET("sse2")
+void SplitUVRow_SSE2(const uint8_t *uv, uint8_t *u, uint8_t *v, int width) {
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + 2 * x));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(uv + 2 * x + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(u + x),
+                         _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(v + x),
+                         _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    SplitUVRow_C(uv + 2 * x, u + x, v + x, width - x);
+}
+
+LIVEKIT_TARGET("avx2")
+void SplitUVRow_AVX2(const uint8_t *uv, uint8_t *u, uint8_t *v, int width) {
+    const __m256i mask = _mm256_set1_epi16(0x00FF);
+
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(uv + 2 * x));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(uv + 2 * x + 32));
+        __m256i uu = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i vv = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(u + x), _mm256_permute4x64_epi64(uu, 0xD8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(v + x), _mm256_permute4x64_epi64(vv, 0xD8));
+    }
+    _mm256_zeroupper();
+    SplitUVRow_SSE2(uv + 2 * x, u + x, v + x, width - x);
+}
+
+LIVEKIT_TARGET("sse4.1")
+void ARGBToYRow_SSE41(const uint8_t *src, uint8_t *y, int width) {
+    const __m128i coeffs = _mm_setr_epi8(kBToY, kGToY, kRToY, 0, kBToY, kGToY, kRToY, 0,
+                                         kBToY, kGToY, kRToY, 0, kBToY, kGToY, kRToY, 0);
+    const __m128i k64 = _mm_set1_epi16(64), k16 = _mm_set1_epi16(16);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i *in = reinterpret_cast<const __m128i *>(src + 4 * x);
+        __m128i m0 = _mm_maddubs_epi16(_mm_loadu_si128(in + 0), coeffs);
+        __m128i m1 = _mm_maddubs_epi16(_mm_loadu_si128(in + 1), coeffs);
+        __m128i m2 = _mm_maddubs_epi16(_mm_loadu_si128(in + 2), coeffs);
+        __m128i m3 = _mm_maddubs_epi16(_mm_loadu_si128(in + 3), coeffs);
+        __m128i y0 = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(_mm_hadd_epi16(m0, m1), k64), 7), k16);
+        __m128i y1 = _mm_add_epi16(_mm_srli_epi16(_mm_add_epi16(_mm_hadd_epi16(m2, m3), k64), 7), k16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(y + x), _mm_packus_epi16(y0, y1));
+    }
+    ARGBToYRow_C(src + 4 * x, y + x, width - x);
+}
+
+LIVEKIT_TARGET("sse4.1")
+void ARGBToUVRow_SSE41(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, int width) {
+    const __m128i uCoeffs = _mm_setr_epi8(kBToU, kGToU, kRToU, 0, kBToU, kGToU, kRToU, 0,
+                                          kBToU, kGToU, kRToU, 0, kBToU, kGToU, kRToU, 0);
+    const __m128i vCoeffs = _mm_setr_epi8(kBToV, kGToV, kRToV, 0, kBToV, kGToV, kRToV, 0,
+                                          kBToV, kGToV, kRToV, 0, kBToV, kGToV, kRToV, 0);
+    const __m128i k128 = _mm_set1_epi16(128);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i *in0 = reinterpret_cast<const __m128i *>(src0 + 4 * x);
+        const __m128i *in1 = reinterpret_cast<const __m128i *>(src1 + 4 * x);
+        __m128 rows[4];
+        for (int i = 0; i < 4; ++i) {
+            rows[i] = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(in0 + i), _mm_loadu_si128(in1 + i)));
+        }
+
+        // Average even and odd pixels
+        __m128i p0 = _mm_avg_epu8(_mm_castps_si128(_mm_shuffle_ps(rows[0], rows[1], _MM_SHUFFLE(2, 0, 2, 0))),
+                                  _mm_castps_si128(_mm_shuffle_ps(rows[0], rows[1], _MM_SHUFFLE(3, 1, 3, 1))));
+        __m128i p1 = _mm_avg_epu8(_mm_castps_si128(_mm_shuffle_ps(rows[2], rows[3], _MM_SHUFFLE(2, 0, 2, 0))),
+                                  _mm_castps_si128(_mm_shuffle_ps(rows[2], rows[3], _MM_SHUFFLE(3, 1, 3, 1))));
+
+        __m128i uu = _mm_hadd_epi16(_mm_maddubs_epi16(p0, uCoeffs), _mm_maddubs_epi16(p1, uCoeffs));
+        __m128i vv = _mm_hadd_epi16(_mm_maddubs_epi16(p0, vCoeffs), _mm_maddubs_epi16(p1, vCoeffs));
+        uu = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(uu, k128), 8), k128);
+        vv = _mm_add_epi16(_mm_srai_epi16(_mm_add_epi16(vv, k128), 8), k128);
+
+        __m128i packed = _mm_packus_epi16(uu, vv);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(u + x / 2), packed);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(v + x / 2), _mm_srli_si128(packed, 8));
+    }
+    ARGBToUVRow_C(src0 + 4 * x, src1 + 4 * x, u + x / 2, v + x / 2, width - x);
+}
+
+#elif defined(LIVEKIT_NEON)
+
+void I420ToRGBARow_NEON(const uint8_t *y, const uint8_t *u, const uint8_t *v, uint8_t *dst, int width) {
+    const int16x8_t k16 = vdupq_n_s16(16), k128 = vdupq_n_s16(128), k32 = vdupq_n_s16(32);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t y8 = vld1q_u8(y + x);
+        uint8x8_t u8 = vld1_u8(u + x / 2);
+        uint8x8_t v8 = vld1_u8(v + x / 2);
+        uint8x8x2_t uu = vzip_u8(u8, u8);
+        uint8x8x2_t vv = vzip_u8(v8, v8);
+
+        uint8x8_t r[2], g[2], b[2];
+        for (int half = 0; half < 2; ++half) {
+            int16x8_t yy = vreinterpretq_s16_u16(vmovl_u8(half ? vget_high_u8(y8) : vget_low_u8(y8)));
+            int16x8_t u1 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(uu.val[half])), k128);
+            int16x8_t v1 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vv.val[half])), k128);
+            yy = vmulq_n_s16(vsubq_s16(yy, k16), kYToRGB);
+
+            r[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqaddq_s16(yy, vmulq_n_s16(v1, kVToR)), k32), 6));
+            g[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqsubq_s16(vqsubq_s16(yy, vmulq_n_s16(u1, kUToG)),
+                                                                    vmulq_n_s16(v1, kVToG)), k32), 6));
+            b[half] = vqmovun_s16(vshrq_n_s16(vqaddq_s16(vqaddq_s16(yy, vmulq_n_s16(u1, kUToB)), k32), 6));
+        }
+
+        uint8x16x4_t rgba;
+        rgba.val[0] = vcombine_u8(r[0], r[1]);
+        rgba.val[1] = vcombine_u8(g[0], g[1]);
+        rgba.val[2] = vcombine_u8(b[0], b[1]);
+        rgba.val[3] = vdupq_n_u8(255);
+        vst4q_u8(dst + 4 * x, rgba);
+    }
+    I420ToRGBARow_C(y + x, u + x / 2, v + x / 2, dst + 4 * x, width - x);
+}
+
+void SplitUVRow_NEON(const uint8_t *uv, uint8_t *u, uint8_t *v, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x2_t split = vld2q_u8(uv + 2 * x);
+        vst1q_u8(u + x, split.val[0]);
+        vst1q_u8(v + x, split.val[1]);
+    }
+    SplitUVRow_C(uv + 2 * x, u + x, v + x, width - x);
+}
+
+void ARGBToYRow_NEON(const uint8_t *src, uint8_t *y, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t bgra = vld4q_u8(src + 4 * x);
+        uint8x8_t out[2];
+        for (int half = 0; half < 2; ++half) {
+            uint8x8_t b = half ? vget_high_u8(bgra.val[0]) : vget_low_u8(bgra.val[0]);
+            uint8x8_t g = half ? vget_high_u8(bgra.val[1]) : vget_low_u8(bgra.val[1]);
+            uint8x8_t r = half ? vget_high_u8(bgra.val[2]) : vget_low_u8(bgra.val[2]);
+            uint16x8_t sum = vmull_u8(b, vdup_n_u8(kBToY));
+            sum = vmlal_u8(sum, g, vdup_n_u8(kGToY));
+            sum = vmlal_u8(sum, r, vdup_n_u8(kRToY));
+            out[half] = vadd_u8(vrshrn_n_u16(sum, 7), vdup_n_u8(16));
+        }
+        vst1q_u8(y + x, vcombine_u8(out[0], out[1]));
+    }
+    ARGBToYRow_C(src + 4 * x, y + x, width - x);
+}
+
+void ARGBToUVRow_NEON(const uint8_t *src0, const uint8_t *src1, uint8_t *u, uint8_t *v, int width) {
+    const int16x8_t k128 = vdupq_n_s16(128);
+
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t row0 = vld4q_u8(src0 + 4 * x);
+        uint8x16x4_t row1 = vld4q_u8(src1 + 4 * x);
+
+        int16x8_t channels[3];
+        for (int c = 0; c < 3; ++c) {
+            uint8x16_t rows = vrhaddq_u8(row0.val[c], row1.val[c]);
+            uint8x8x2_t evenOdd = vuzp_u8(vget_low_u8(rows), vget_high_u8(rows));
+            channels[c] = vreinterpretq_s16_u16(vmovl_u8(vrhadd_u8(evenOdd.val[0], evenOdd.val[1])));
+        }
+        int16x8_t b = channels[0], g = channels[1], r = channels[2];
+
+        int16x8_t uu = vmulq_n_s16(b, kBToU);
+        uu = vmlsq_n_s16(uu, g, -kGToU);
+        uu = vmlsq_n_s16(uu, r, -kRToU);
+        int16x8_t vv = vmulq_n_s16(r, kRToV);
+        vv = vmlsq_n_s16(vv, g, -kGToV);
+        vv = vmlsq_n_s16(vv, b, -kBToV);
+
+        uu = vaddq_s16(vshrq_n_s16(vaddq_s16(uu, k128), 8), k128);
+        vv = vaddq_s16(vshrq_n_s16(vaddq_s16(vv, k128), 8), k128);
+        vst1_u8(u + x / 2, vqmovun_s16(uu));
+        vst1_u8(v + x / 2, vqmovun_s16(vv));
+    }
+    ARGBToUVRow_C(src0 + 4 * x, src1 + 4 * x, u + x / 2, v + x / 2, width - x);
+}
+
+#endif
+
+struct Kernels {
+    I420ToRGBARowFn i420ToRGBA = I420ToRGBARow_C;
+    SplitUVRowFn splitUV = SplitUVRow_C;
+    ARGBToYRowFn argbToY = ARGBToYRow_C;
+    ARGBToUVRowFn argbToUV = ARGBToUVRow_C;
+};
+
+Kernels SelectKernels() {
+    Kernels kernels;
+    const CpuFeatures& cpu = CpuFeatures::Get();
+    (void)cpu;
+#if defined(LIVEKIT_X86)
+    if (cpu.sse2) {
+        kernels.i420ToRGBA = I420ToRGBARow_SSE2;
+        kernels.splitUV = SplitUVRow_SSE2;
+    }
+    if (cpu.sse41) {
+        kernels.argbToY = ARGBToYRow_SSE41;
+        kernels.argbToUV = ARGBToUVRow_SSE41;
+    }
+    if (cpu.avx2) {
+        kernels.i420ToRGBA = I420ToRGBARow_AVX2;
+        kernels.splitUV = SplitUVRow_AVX2;
+    }
+#elif defined(LIVEKIT_NEON)
+    kernels.i420ToRGBA = I420ToRGBARow_NEON;
+    kernels.splitUV = SplitUVRow_NEON;
+    kernels.argbToY = ARGBToYRow_NEON;
+    kernels.argbToUV = ARGBToUVRow_NEON;
+#endif
+    return kernels;
+}
+
+const Kernels& GetKernels() {
+    static const Kernels kernels = SelectKernels();
+    return kernels;
+}
+
+void CopyPlane(const uint8_t *src, int srcStride, uint8_t *dst, int dstStride, int width, int height) {
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(dst + static_cast<ptrdiff_t>(y) * dstStride, src + static_cast<ptrdiff_t>(y) * srcStride, width);
+    }
+}
+
+void CheckType(const VideoFrameBuffer& buffer, VideoFrameBufferType type, const char *error) {
+    if (buffer.GetType() != type && !(type == VideoFrameBufferType::I420 && buffer.GetType() == VideoFrameBufferType::I420A)) {
+        throw std::invalid_argument(error);
+    }
+}
+
+}
+
+void I420ToRGBA(const uint8_t *srcY, int srcStrideY,
+                const uint8_t *srcU, int srcStrideU,
+                const uint8_t *srcV, int srcStrideV,
+                uint8_t *dst, int dstStride,
+                int width, int height) {
+    I420ToRGBARowFn row = GetKernels().i420ToRGBA;
+    for (int y = 0; y < height; ++y) {
+        row(srcY + static_cast<ptrdiff_t>(y) * srcStrideY,
+            srcU + static_cast<ptrdiff_t>(y / 2) * srcStrideU,
+            srcV + static_cast<ptrdiff_t>(y / 2) * srcStrideV,
+            dst + static_cast<ptrdiff_t>(y) * dstStride, width);
+    }
+}
+
+void NV12ToI420(const uint8_t *srcY, int srcStrideY,
+                const uint8_t *srcUV, int srcStrideUV,
+                uint8_t *dstY, int dstStrideY,
+                uint8_t *dstU, int dstStrideU,
+                uint8_t *dstV, int dstStrideV,
+                int width, int height) {
+    CopyPlane(srcY, srcStrideY, dstY, dstStrideY, width, height);
+
+    SplitUVRowFn row = GetKernels().splitUV;
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+    for (int y = 0; y < chromaHeight; ++y) {
+        row(srcUV + static_cast<ptrdiff_t>(y) * srcStrideUV,
+            dstU + static_cast<ptrdiff_t>(y) * dstStrideU,
+            dstV + static_cast<ptrdiff_t>(y) * dstStrideV, chromaWidth);
+    }
+}
+
+void ARGBToI420(const uint8_t *src, int srcStride,
+                uint8_t *dstY, int dstStrideY,
+                uint8_t *dstU, int dstStrideU,
+                uint8_t *dstV, int dstStrideV,
+                int width, int height) {
+    const Kernels& kernels = GetKernels();
+    for (int y = 0; y < height; y += 2) {
+        const uint8_t *row0 = src + static_cast<ptrdiff_t>(y) * srcStride;
+        // The last chroma row of an odd height only has one row of pixels
+        const uint8_t *row1 = y + 1 < height ? row0 + srcStride : row0;
+
+        kernels.argbToY(row0, dstY + static_cast<ptrdiff_t>(y) * dstStrideY, width);
+        if (y + 1 < height) {
+            kernels.argbToY(row1, dstY + static_cast<ptrdiff_t>(y + 1) * dstStrideY, width);
+        }
+        kernels.argbToUV(row0, row1, dstU + static_cast<ptrdiff_t>(y / 2) * dstStrideU,
+                         dstV + static_cast<ptrdiff_t>(y / 2) * dstStrideV, width);
+    }
+}
+
+void ScalePlane(const uint8_t *src, int srcStride, int srcWidth, int srcHeight,
+                uint8_t *dst, int dstStride, int dstWidth, int dstHeight) {
+    if (srcWidth == dstWidth && srcHeight == dstHeight) {
+        CopyPlane(src, srcStride, dst, dstStride, dstWidth, dstHeight);
+        return;
+    }
+    if (srcWidth <= 0 || srcHeight <= 0 || dstWidth <= 0 || dstHeight <= 0) {
+        return;
+    }
+
+    // 16.16 fixed point positions, sampling at the pixel centers
+    const int64_t stepX = (static_cast<int64_t>(srcWidth) << 16) / dstWidth;
+    const int64_t stepY = (static_cast<int64_t>(srcHeight) << 16) / dstHeight;
+    const int64_t maxX = static_cast<int64_t>(srcWidth - 1) << 16;
+    const int64_t maxY = static_cast<int64_t>(srcHeight - 1) << 16;
+
+    for (int y = 0; y < dstHeight; ++y) {
+        int64_t sy = std::clamp<int64_t>(stepY * y + stepY / 2 - 0x8000, 0, maxY);
+        int y0 = static_cast<int>(sy >> 16);
+        int y1 = std::min(y0 + 1, srcHeight - 1);
+        int wy = static_cast<int>((sy >> 8) & 0xFF);
+
+        const uint8_t *row0 = src + static_cast<ptrdiff_t>(y0) * srcStride;
+        const uint8_t *row1 = src + static_cast<ptrdiff_t>(y1) * srcStride;
+        uint8_t *out = dst + static_cast<ptrdiff_t>(y) * dstStride;
+        for (int x = 0; x < dstWidth; ++x) {
+            int64_t sx = std::clamp<int64_t>(stepX * x + stepX / 2 - 0x8000, 0, maxX);
+            int x0 = static_cast<int>(sx >> 16);
+            int x1 = std::min(x0 + 1, srcWidth - 1);
+            int wx = static_cast<int>((sx >> 8) & 0xFF);
+
+            int top = row0[x0] * (256 - wx) + row0[x1] * wx;
+            int bottom = row1[x0] * (256 - wx) + row1[x1] * wx;
+            out[x] = static_cast<uint8_t>((top * (256 - wy) + bottom * wy + 0x8000) >> 16);
+        }
+    }
+}
+
+void I420ToRGBA(const VideoFrameBuffer& src, uint8_t *dst, int dstStride) {
+    CheckType(src, VideoFrameBufferType::I420, "I420ToRGBA expects an I420 buffer");
+    I420ToRGBA(src.GetData(0), src.GetStride(0), src.GetData(1), src.GetStride(1), src.GetData(2), src.GetStride(2),
+               dst, dstStride, src.GetWidth(), src.GetHeight());
+}
+
+void NV12ToI420(const VideoFrameBuffer& src, VideoFrameBuffer& dst) {
+    CheckType(src, VideoFrameBufferType::NV12, "NV12ToI420 expects an NV12 source");
+    CheckType(dst, VideoFrameBufferType::I420, "NV12ToI420 expects an I420 destination");
+    if (src.GetWidth() != dst.GetWidth() || src.GetHeight() != dst.GetHeight()) {
+        throw std::invalid_argument("NV12ToI420 expects buffers of the same size");
+    }
+    NV12ToI420(src.GetData(0), src.GetStride(0), src.GetData(1), src.GetStride(1),
+               dst.GetMutableData(0), dst.GetStride(0), dst.GetMutableData(1), dst.GetStride(1),
+               dst.GetMutableData(2), dst.GetStride(2), dst.GetWidth(), dst.GetHeight());
+}
+
+void ARGBToI420(const uint8_t *src, int srcStride, VideoFrameBuffer& dst) {
+    CheckType(dst, VideoFrameBufferType::I420, "ARGBToI420 expects an I420 destination");
+    ARGBToI420(src, srcStride, dst.GetMutableData(0), dst.GetStride(0), dst.GetMutableData(1), dst.GetStride(1),
+               dst.GetMutableData(2), dst.GetStride(2), dst.GetWidth(), dst.GetHeight());
+}
+
+void I420Scale(const VideoFrameBuffer& src, VideoFrameBuffer& dst) {
+    CheckType(src, VideoFrameBufferType::I420, "I420Scale expects an I420 source");
+    CheckType(dst, VideoFrameBufferType::I420, "I420Scale expects an I420 destination");
+    for (size_t i = 0; i < 3; ++i) {
+        const VideoPlane& from = src.GetPlane(i);
+        const VideoPlane& to = dst.GetPlane(i);
+        ScalePlane(from.data, from.stride, from.width, from.height, to.data, to.stride, to.width, to.height);
+    }
+}
+
+}
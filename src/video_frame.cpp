@@ -0,0 +1,137 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/video_frame.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+uint8_t *ToPointer(uint64_t ptr) {
+    return reinterpret_cast<uint8_t *>(static_cast<uintptr_t>(ptr));
+}
+
+// 10 bits samples are stored on 16 bits
+size_t BytesPerSample(VideoFrameBufferType type) {
+    return type == VideoFrameBufferType::I010 ? 2 : 1;
+}
+
+}
+
+VideoFrameBuffer::VideoFrameBuffer(const VideoFrameBufferInfo& info)
+    : handle_(info.handle().id()), type_(info.buffer_type()), width_(info.width()), height_(info.height()) {
+    switch (type_) {
+        case VideoFrameBufferType::I420:
+        case VideoFrameBufferType::I420A:
+        case VideoFrameBufferType::I422:
+        case VideoFrameBufferType::I444:
+        case VideoFrameBufferType::I010: {
+            const PlanarYuvBufferInfo& yuv = info.yuv();
+            // 10 bits samples are stored on 16 bits, widths stay in samples
+            planes_[0] = {ToPointer(yuv.data_y_ptr()), yuv.stride_y(), width_, height_};
+            planes_[1] = {ToPointer(yuv.data_u_ptr()), yuv.stride_u(), yuv.chroma_width(), yuv.chroma_height()};
+            planes_[2] = {ToPointer(yuv.data_v_ptr()), yuv.stride_v(), yuv.chroma_width(), yuv.chroma_height()};
+            numPlanes_ = 3;
+            if (type_ == VideoFrameBufferType::I420A) {
+                planes_[3] = {ToPointer(yuv.data_a_ptr()), yuv.stride_a(), width_, height_};
+                numPlanes_ = 4;
+            }
+            break;
+        }
+        case VideoFrameBufferType::NV12: {
+            const BiplanarYuvBufferInfo& biYuv = info.bi_yuv();
+            // Interleaved U and V, two samples per chroma pixel
+            planes_[0] = {ToPointer(biYuv.data_y_ptr()), biYuv.stride_y(), width_, height_};
+            planes_[1] = {ToPointer(biYuv.data_uv_ptr()), biYuv.stride_uv(), biYuv.chroma_width() * 2, biYuv.chroma_height()};
+            numPlanes_ = 2;
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+VideoFrameBuffer::VideoFrameBuffer(VideoFrameBufferType type, uint32_t width, uint32_t height,
+                                   const VideoPlane *planes, size_t numPlanes, std::shared_ptr<void> memory)
+    : handle_(INVALID_HANDLE), memory_(std::move(memory)), type_(type), width_(width), height_(height), numPlanes_(numPlanes) {
+    if (type == VideoFrameBufferType::NATIVE) {
+        throw std::invalid_argument("native buffers can't wrap application memory");
+    }
+    if (numPlanes == 0 || numPlanes > planes_.size()) {
+        throw std::invalid_argument("a video buffer has between 1 and 4 planes");
+    }
+    for (size_t i = 0; i < numPlanes; ++i) {
+        planes_[i] = planes[i];
+    }
+}
+
+std::unique_ptr<VideoFrameBuffer> VideoFrameBuffer::Allocate(VideoFrameBufferType type, uint32_t width, uint32_t height) {
+    AllocVideoBufferRequest *allocRequest = new AllocVideoBufferRequest;
+    allocRequest->set_type(type);
+    allocRequest->set_width(width);
+    allocRequest->set_height(height);
+
+    FFIRequest request;
+    request.set_allocated_alloc_video_buffer(allocRequest);
+
+    FFIResponse response = FfiClient::getInstance().SendRequest(request);
+    if (!response.has_alloc_video_buffer()) {
+        throw std::runtime_error("failed to allocate a video buffer");
+    }
+    return std::make_unique<VideoFrameBuffer>(response.alloc_video_buffer().buffer());
+}
+
+void VideoFrameBuffer::CopyTo(VideoFrameBuffer& dst) const {
+    if (IsNative() || dst.type_ != type_ || dst.width_ != width_ || dst.height_ != height_ ||
+        dst.numPlanes_ != numPlanes_) {
+        throw std::invalid_argument("CopyTo expects a CPU buffer of the same type and size");
+    }
+    const size_t bytesPerSample = BytesPerSample(type_);
+    for (size_t i = 0; i < numPlanes_; ++i) {
+        const VideoPlane& from = planes_[i];
+        const VideoPlane& to = dst.planes_[i];
+        const size_t rowBytes = static_cast<size_t>(from.width) * bytesPerSample;
+        if (from.height == 0) {
+            continue;
+        }
+        if (from.stride == to.stride) {
+            // The padding of the last row may not be there
+            std::memcpy(to.data, from.data, static_cast<size_t>(from.stride) * (from.height - 1) + rowBytes);
+            continue;
+        }
+        for (uint32_t y = 0; y < from.height; ++y) {
+            std::memcpy(to.data + static_cast<size_t>(y) * to.stride, from.data + static_cast<size_t>(y) * from.stride,
+                        rowBytes);
+        }
+    }
+}
+
+VideoFrame VideoFrame::FromEvent(const FrameReceived& event) {
+    return VideoFrame{
+        event.frame().timestamp_us(),
+        event.frame().rotation(),
+        std::make_shared<VideoFrameBuffer>(event.buffer()),
+    };
+}
+
+}
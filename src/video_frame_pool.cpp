@@ -0,0 +1,103 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/video_frame_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace livekit
+{
+
+VideoFramePool::VideoFramePool(VideoFrameBufferType type, uint32_t width, uint32_t height, size_t maxFree,
+                               std::shared_ptr<VideoBufferAllocator> allocator)
+    : state_(std::make_shared<State>()) {
+    if (type == VideoFrameBufferType::NATIVE) {
+        throw std::invalid_argument("native buffers can't be pooled");
+    }
+    state_->type = type;
+    state_->width = width;
+    state_->height = height;
+    state_->maxFree = maxFree;
+    state_->allocator = allocator ? std::move(allocator) : std::make_shared<FfiVideoBufferAllocator>();
+}
+
+std::shared_ptr<VideoFrameBuffer> VideoFramePool::Acquire() {
+    std::unique_ptr<VideoFrameBuffer> buffer;
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        if (!state_->free.empty()) {
+            buffer = std::move(state_->free.back());
+            state_->free.pop_back();
+        }
+    }
+
+    if (!buffer) {
+        buffer = state_->allocator->Allocate(state_->type, state_->width, state_->height);
+    }
+
+    std::weak_ptr<State> pool = state_;
+    return std::shared_ptr<VideoFrameBuffer>(buffer.release(), [pool](VideoFrameBuffer *buffer) {
+        Release(pool, buffer);
+    });
+}
+
+void VideoFramePool::Reserve(size_t count) {
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        size_t room = state_->maxFree - std::min(state_->free.size(), state_->maxFree);
+        count = std::min(count, room);
+    }
+
+    std::vector<std::unique_ptr<VideoFrameBuffer>> buffers;
+    for (size_t i = 0; i < count; ++i) {
+        auto buffer = state_->allocator->Allocate(state_->type, state_->width, state_->height);
+        for (size_t plane = 0; plane < buffer->NumPlanes(); ++plane) {
+            const VideoPlane& p = buffer->GetPlane(plane);
+            std::memset(p.data, 0, static_cast<size_t>(p.stride) * p.height);
+        }
+        buffers.push_back(std::move(buffer));
+    }
+
+    // Buffers released meanwhile may have filled the pool, the extra ones
+    // are dropped
+    std::lock_guard<std::mutex> guard(state_->lock);
+    for (auto& buffer : buffers) {
+        if (state_->free.size() >= state_->maxFree) {
+            break;
+        }
+        state_->free.push_back(std::move(buffer));
+    }
+}
+
+size_t VideoFramePool::FreeCount() const {
+    std::lock_guard<std::mutex> guard(state_->lock);
+    return state_->free.size();
+}
+
+void VideoFramePool::Release(const std::weak_ptr<State>& pool, VideoFrameBuffer *buffer) {
+    std::unique_ptr<VideoFrameBuffer> owned(buffer);
+    if (std::shared_ptr<State> state = pool.lock()) {
+        std::lock_guard<std::mutex> guard(state->lock);
+        if (state->free.size() < state->maxFree) {
+            state->free.push_back(std::move(owned));
+        }
+    }
+    // Otherwise the buffer handle is dropped here
+}
+
+}
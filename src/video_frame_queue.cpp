@@ -0,0 +1,160 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/video_frame_queue.h"
+
+#include <stdexcept>
+
+namespace livekit
+{
+
+VideoFrameQueue::VideoFrameQueue(uint64_t streamHandle, const VideoDeliveryOptions& options)
+    : state_(std::make_shared<State>()) {
+    if (options.policy != VideoDelivery::LatestOnly && options.depth == 0) {
+        throw std::invalid_argument("a video frame queue needs a depth");
+    }
+    state_->options = options;
+
+    std::weak_ptr<State> weak = state_;
+    listenerId_ = FfiClient::getInstance().Subscribe<VideoStreamEvent>(
+        EventSubscription::ForHandle(streamHandle), [weak](const VideoStreamEvent& event) {
+            if (!event.has_frame_received()) {
+                return;
+            }
+            // Taken over even once the queue is gone, so the buffer is released
+            VideoFrame frame = VideoFrame::FromEvent(event.frame_received());
+            if (std::shared_ptr<State> state = weak.lock()) {
+                state->Push(state->Land(std::move(frame)));
+            }
+        });
+}
+
+VideoFrameQueue::~VideoFrameQueue() {
+    FfiClient::getInstance().RemoveListener(listenerId_);
+
+    std::deque<VideoFrame> frames;
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        state_->closed = true;
+        frames.swap(state_->frames);
+    }
+    state_->notFull.notify_all();
+}
+
+std::optional<VideoFrame> VideoFrameQueue::TryPop() {
+    std::optional<VideoFrame> frame;
+    {
+        std::lock_guard<std::mutex> guard(state_->lock);
+        frame = state_->PopLocked();
+    }
+    if (frame) {
+        state_->notFull.notify_one();
+    }
+    return frame;
+}
+
+std::optional<VideoFrame> VideoFrameQueue::WaitPop(std::chrono::milliseconds timeout) {
+    std::optional<VideoFrame> frame;
+    {
+        std::unique_lock<std::mutex> guard(state_->lock);
+        auto ready = [this]() { return !state_->frames.empty(); };
+        if (timeout == std::chrono::milliseconds::max()) {
+            state_->notEmpty.wait(guard, ready);
+        } else {
+            state_->notEmpty.wait_for(guard, timeout, ready);
+        }
+        frame = state_->PopLocked();
+    }
+    if (frame) {
+        state_->notFull.notify_one();
+    }
+    return frame;
+}
+
+void VideoFrameQueue::Push(VideoFrame frame) {
+    state_->Push(std::move(frame));
+}
+
+VideoDeliveryStats VideoFrameQueue::GetStats() const {
+    std::lock_guard<std::mutex> guard(state_->lock);
+    VideoDeliveryStats stats = state_->stats;
+    stats.depth = state_->frames.size();
+    return stats;
+}
+
+void VideoFrameQueue::State::Push(VideoFrame frame) {
+    // Released once the lock is given up, dropping a buffer is an FFI call
+    std::optional<VideoFrame> stale;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        ++stats.received;
+        if (options.policy == VideoDelivery::Block) {
+            notFull.wait(guard, [this]() { return closed || frames.size() < options.depth; });
+        }
+        if (closed) {
+            ++stats.dropped;
+            return;
+        }
+
+        if (options.policy == VideoDelivery::LatestOnly && !frames.empty()) {
+            stale = std::move(frames.front());
+            frames.clear();
+            ++stats.coalesced;
+        } else if (options.policy == VideoDelivery::Bounded && frames.size() >= options.depth) {
+            stale = std::move(frames.front());
+            frames.pop_front();
+            ++stats.dropped;
+        }
+        frames.push_back(std::move(frame));
+    }
+    notEmpty.notify_one();
+}
+
+VideoFrame VideoFrameQueue::State::Land(VideoFrame frame) {
+    if (!options.allocator || !frame.buffer || frame.buffer->IsNative()) {
+        return frame;
+    }
+    const VideoFrameBuffer& received = *frame.buffer;
+
+    std::shared_ptr<VideoFrameBuffer> buffer;
+    {
+        std::lock_guard<std::mutex> guard(landingLock);
+        if (!landing || landing->GetType() != received.GetType() || landing->GetWidth() != received.GetWidth() ||
+            landing->GetHeight() != received.GetHeight()) {
+            // Enough for a full queue, the frame being consumed and this one
+            landing = std::make_unique<VideoFramePool>(received.GetType(), received.GetWidth(), received.GetHeight(),
+                                                       options.depth + 2, options.allocator);
+        }
+        buffer = landing->Acquire();
+    }
+    received.CopyTo(*buffer);
+    // Drops the FFI buffer
+    frame.buffer = std::move(buffer);
+    return frame;
+}
+
+// Called with the lock held
+std::optional<VideoFrame> VideoFrameQueue::State::PopLocked() {
+    if (frames.empty()) {
+        return std::nullopt;
+    }
+    VideoFrame frame = std::move(frames.front());
+    frames.pop_front();
+    ++stats.delivered;
+    return frame;
+}
+
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "video_sink_set.h"
+
+#include <algorithm>
+
+namespace livekit
+{
+
+namespace
+{
+
+// Assumed when the publication doesn't tell its size
+constexpr uint32_t kDefaultWidth = 1280;
+constexpr uint32_t kDefaultHeight = 720;
+
+}
+
+VideoSinkSet::SinkId VideoSinkSet::Add(const std::string& trackSid, const VideoSinkSettings& settings) {
+    SinkId id = nextId_++;
+    sinkTracks_.emplace(id, trackSid);
+    Track& track = tracks_[trackSid];
+    track.sinks.emplace(id, settings);
+    ++track.generation;
+    return id;
+}
+
+std::string VideoSinkSet::Update(SinkId id, const VideoSinkSettings& settings) {
+    auto it = sinkTracks_.find(id);
+    if (it == sinkTracks_.end()) {
+        return std::string();
+    }
+    Track& track = tracks_[it->second];
+    track.sinks[id] = settings;
+    ++track.generation;
+    return it->second;
+}
+
+std::string VideoSinkSet::Remove(SinkId id) {
+    auto it = sinkTracks_.find(id);
+    if (it == sinkTracks_.end()) {
+        return std::string();
+    }
+    std::string trackSid = std::move(it->second);
+    sinkTracks_.erase(it);
+    Track& track = tracks_[trackSid];
+    track.sinks.erase(id);
+    ++track.generation;
+    return trackSid;
+}
+
+std::optional<TrackSettings> VideoSinkSet::Resolve(const std::string& trackSid, uint32_t publishedWidth,
+                                                   uint32_t publishedHeight) {
+    auto it = tracks_.find(trackSid);
+    if (it == tracks_.end()) {
+        return std::nullopt;
+    }
+
+    Track& track = it->second;
+    if (track.sinks.empty()) {
+        // Back to the defaults once the last sink is gone, the track is
+        // forgotten once they are sent
+        if (track.sent && *track.sent != TrackSettings{}) {
+            return TrackSettings{};
+        }
+        tracks_.erase(it);
+        return std::nullopt;
+    }
+
+    TrackSettings settings;
+    settings.disabled = true;
+    bool anyRate = false;
+    for (const auto& [_, sink] : track.sinks) {
+        if (!sink.visible) {
+            continue;
+        }
+        settings.disabled = false;
+        settings.width = std::max(settings.width, sink.width);
+        settings.height = std::max(settings.height, sink.height);
+        settings.fps = std::max(settings.fps, sink.fps);
+        anyRate = anyRate || sink.fps == 0;
+    }
+    if (anyRate) {
+        settings.fps = 0;
+    }
+    settings.quality = settings.disabled ? VideoQuality::VIDEO_QUALITY_LOW
+                                         : SelectQuality(settings.width, settings.height, publishedWidth, publishedHeight);
+
+    if (track.sent == settings) {
+        return std::nullopt;
+    }
+    return settings;
+}
+
+bool VideoSinkSet::BeginSend(const std::string& trackSid) {
+    auto it = tracks_.find(trackSid);
+    if (it == tracks_.end() || it->second.sending) {
+        return false;
+    }
+    it->second.sending = true;
+    return true;
+}
+
+void VideoSinkSet::EndSend(const std::string& trackSid) {
+    auto it = tracks_.find(trackSid);
+    if (it != tracks_.end()) {
+        it->second.sending = false;
+    }
+}
+
+uint64_t VideoSinkSet::GetGeneration(const std::string& trackSid) const {
+    auto it = tracks_.find(trackSid);
+    return it != tracks_.end() ? it->second.generation : 0;
+}
+
+bool VideoSinkSet::MarkSent(const std::string& trackSid, const TrackSettings& settings, uint64_t generation) {
+    auto it = tracks_.find(trackSid);
+    if (it == tracks_.end()) {
+        return true;
+    }
+    Track& track = it->second;
+    track.sent = settings;
+    if (track.generation != generation) {
+        return false;
+    }
+    if (track.sinks.empty()) {
+        tracks_.erase(it);
+    } else {
+        track.sending = false;
+    }
+    return true;
+}
+
+// Simulcast layers are published at full, half and quarter resolution: pick
+// the smallest one that covers the sink in both dimensions
+VideoQuality VideoSinkSet::SelectQuality(uint32_t width, uint32_t height, uint32_t publishedWidth,
+                                         uint32_t publishedHeight) {
+    if (width == 0 && height == 0) {
+        return VideoQuality::VIDEO_QUALITY_HIGH;
+    }
+    if (publishedWidth == 0 || publishedHeight == 0) {
+        publishedWidth = kDefaultWidth;
+        publishedHeight = kDefaultHeight;
+    }
+
+    // Compared on integers, width / publishedWidth <= 1 / divisor
+    auto fits = [&](uint32_t divisor) {
+        return static_cast<uint64_t>(width) * divisor <= publishedWidth &&
+               static_cast<uint64_t>(height) * divisor <= publishedHeight;
+    };
+    if (fits(4)) {
+        return VideoQuality::VIDEO_QUALITY_LOW;
+    }
+    if (fits(2)) {
+        return VideoQuality::VIDEO_QUALITY_MEDIUM;
+    }
+    return VideoQuality::VIDEO_QUALITY_HIGH;
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVEKIT_VIDEO_SINK_SET_H
+#define LIVEKIT_VIDEO_SINK_SET_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "livekit/room.h"
+#include "room.pb.h"
+
+namespace livekit
+{
+    // What a remote video track is asked for, the fields of an
+    // UpdateTrackSettingsRequest
+    struct TrackSettings {
+        bool disabled = false;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t fps = 0;
+        VideoQuality quality = VideoQuality::VIDEO_QUALITY_HIGH;
+
+        bool operator==(const TrackSettings& other) const {
+            return disabled == other.disabled && width == other.width && height == other.height &&
+                   fps == other.fps && quality == other.quality;
+        }
+        bool operator!=(const TrackSettings& other) const { return !(*this == other); }
+    };
+
+    // The video sinks of a room, by track. A track gets what its largest
+    // visible sink needs (and the highest frame rate asked) and is paused
+    // while none is visible. The settings last sent for each track are kept,
+    // so unchanged sinks don't send anything. Not thread-safe.
+    class VideoSinkSet
+    {
+    public:
+        using SinkId = uint64_t;
+
+        SinkId Add(const std::string& trackSid, const VideoSinkSettings& settings);
+        // Both return the track of the sink, empty if the sink is unknown
+        std::string Update(SinkId id, const VideoSinkSettings& settings);
+        std::string Remove(SinkId id);
+
+        // Sends are made without the owner's lock, one at a time per track.
+        // False if the track is unknown or another send is in flight, which
+        // then picks the change up.
+        bool BeginSend(const std::string& trackSid);
+        // Ends a send without recording anything, e.g. when it failed
+        void EndSend(const std::string& trackSid);
+        // Bumped on each change of the track's sinks
+        uint64_t GetGeneration(const std::string& trackSid) const;
+
+        // Settings for the track given the size it is published at (0 if
+        // unknown), or nothing if they are the ones last sent
+        std::optional<TrackSettings> Resolve(const std::string& trackSid, uint32_t publishedWidth,
+                                             uint32_t publishedHeight);
+        // Records settings from Resolve once they reached the FFI, so a
+        // failed send is retried on the next update. `generation` is the
+        // one they were resolved at: returns false, the send still in
+        // flight, if the sinks changed since and need resolving again.
+        bool MarkSent(const std::string& trackSid, const TrackSettings& settings, uint64_t generation);
+
+        static VideoQuality SelectQuality(uint32_t width, uint32_t height, uint32_t publishedWidth,
+                                          uint32_t publishedHeight);
+
+    private:
+        struct Track {
+            std::unordered_map<SinkId, VideoSinkSettings> sinks;
+            std::optional<TrackSettings> sent;
+            uint64_t generation = 0;
+            bool sending = false;
+        };
+
+        SinkId nextId_ = 1;
+        std::unordered_map<SinkId, std::string> sinkTracks_;
+        std::unordered_map<std::string, Track> tracks_;
+    };
+}
+
+#endif /* LIVEKIT_VIDEO_SINK_SET_H */
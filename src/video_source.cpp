@@ -0,0 +1,120 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "livekit/video_source.h"
+
+#include <stdexcept>
+
+#include "ffi.pb.h"
+
+namespace livekit
+{
+
+namespace
+{
+
+uintptr_t NewVideoSource(uint32_t width, uint32_t height, double frameRate) {
+    if (width == 0 || height == 0 || frameRate <= 0) {
+        throw std::invalid_argument("a video source needs a resolution and a frame rate");
+    }
+
+    NewVideoSourceRequest *sourceRequest = new NewVideoSourceRequest;
+    sourceRequest->set_type(VideoSourceType::VIDEO_SOURCE_NATIVE);
+    VideoSourceResolution *resolution = sourceRequest->mutable_resolution();
+    resolution->set_width(width);
+    resolution->set_height(height);
+    resolution->set_frame_rate(frameRate);
+
+    FFIRequest request;
+    request.set_allocated_new_video_source(sourceRequest);
+
+    FFIResponse response = FfiClient::getInstance().SendRequest(request);
+    if (!response.has_new_video_source()) {
+        throw std::runtime_error("failed to create the video source");
+    }
+    return response.new_video_source().source().handle().id();
+}
+
+}
+
+VideoSource::VideoSource(uint32_t width, uint32_t height, double frameRate)
+    : handle_(NewVideoSource(width, height, frameRate)) {}
+
+void VideoSource::CaptureFrame(const VideoFrame& frame) {
+    if (!frame.buffer) {
+        throw std::invalid_argument("the frame has no buffer");
+    }
+
+    // Kept alive until the FFI is done with it
+    std::shared_ptr<VideoFrameBuffer> staged;
+    uintptr_t buffer = frame.buffer->GetHandle();
+    if (buffer == INVALID_HANDLE) {
+        staged = Stage(*frame.buffer);
+        buffer = staged->GetHandle();
+    }
+
+    FFIRequest request;
+    CaptureVideoFrameRequest *captureRequest = request.mutable_capture_video_frame();
+    captureRequest->mutable_frame()->set_timestamp_us(frame.timestampUs);
+    captureRequest->mutable_frame()->set_rotation(frame.rotation);
+    captureRequest->mutable_buffer_handle()->set_id(buffer);
+    Capture(request);
+}
+
+void VideoSource::CaptureFrame(const uint8_t *data, VideoFormatType format, uint32_t stride,
+                               uint32_t width, uint32_t height, int64_t timestampUs, VideoRotation rotation) {
+    if (!data || stride < static_cast<uint64_t>(width) * 4) {
+        throw std::invalid_argument("the pixels don't fit the stride");
+    }
+
+    FFIRequest request;
+    CaptureVideoFrameRequest *captureRequest = request.mutable_capture_video_frame();
+    captureRequest->mutable_frame()->set_timestamp_us(timestampUs);
+    captureRequest->mutable_frame()->set_rotation(rotation);
+    ARGBBufferInfo *argb = captureRequest->mutable_argb();
+    argb->set_ptr(reinterpret_cast<uintptr_t>(data));
+    argb->set_format(format);
+    argb->set_stride(stride);
+    argb->set_width(width);
+    argb->set_height(height);
+    Capture(request);
+}
+
+void VideoSource::Capture(FFIRequest& request) {
+    request.mutable_capture_video_frame()->mutable_source_handle()->set_id(handle_.handle);
+
+    FFIResponse response;
+    FfiClient::getInstance().SendRequest(request, response);
+    if (!response.has_capture_video_frame()) {
+        throw std::runtime_error("failed to capture a video frame");
+    }
+}
+
+std::shared_ptr<VideoFrameBuffer> VideoSource::Stage(const VideoFrameBuffer& buffer) {
+    std::shared_ptr<VideoFrameBuffer> staged;
+    {
+        std::lock_guard<std::mutex> guard(stagingLock_);
+        if (!staging_ || staging_->GetType() != buffer.GetType() || staging_->GetWidth() != buffer.GetWidth() ||
+            staging_->GetHeight() != buffer.GetHeight()) {
+            staging_ = std::make_unique<VideoFramePool>(buffer.GetType(), buffer.GetWidth(), buffer.GetHeight());
+        }
+        staged = staging_->Acquire();
+    }
+    buffer.CopyTo(*staged);
+    return staged;
+}
+
+}
@@ -0,0 +1,328 @@
+/*
+ * Copyright 2023 LiveKit
+ *
+ * Licensed under the Apache License, Version 2.0 (the “License”);
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an “AS IS” BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Load test of the event path against the simulated FFI: connects rooms
+// full of simulated participants, replays generated (or recorded) room
+// events into each of them at a fixed rate, and reports every second the
+// dispatch throughput, the delivery latency and the memory in use.
+//
+// The latency of an event runs from the time it was due, not from when it
+// was actually emitted, so a dispatch path falling behind shows up in the
+// tail instead of slowing the load down.
+//
+//   livekit_stress --rooms=8 --participants=500 --rate=20000 --seconds=600 --queue=4
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+#include "livekit/event_log.h"
+#include "livekit/ffi_client.h"
+#include "livekit/metrics.h"
+#include "livekit/mock_ffi.h"
+#include "livekit/room.h"
+
+using namespace livekit;
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    size_t rooms = 1;
+    size_t participants = 100;
+    size_t audioTracks = 1;
+    size_t videoTracks = 1;
+    // Per room, 0 replays as fast as possible (latencies are then only
+    // the dispatch itself)
+    double rate = 10000;
+    double seconds = 10;
+    // Generated events replayed in a loop
+    size_t events = 10000;
+    size_t dataBytes = 0;
+    uint64_t seed = 1;
+    // Dispatcher threads of the event queue, 0 dispatches on the emitting
+    // thread. Pinned with more than one, which keeps each room in order.
+    size_t queue = 0;
+    // Event log to replay instead, see EventLogWriter
+    std::string replay;
+};
+
+bool ParseOption(const char *arg, Options& options) {
+    const char *value = std::strchr(arg, '=');
+    if (std::strncmp(arg, "--", 2) != 0 || !value) {
+        return false;
+    }
+    std::string name(arg + 2, value - arg - 2);
+    ++value;
+    if (name == "rooms") {
+        options.rooms = std::strtoull(value, nullptr, 10);
+    } else if (name == "participants") {
+        options.participants = std::strtoull(value, nullptr, 10);
+    } else if (name == "audio") {
+        options.audioTracks = std::strtoull(value, nullptr, 10);
+    } else if (name == "video") {
+        options.videoTracks = std::strtoull(value, nullptr, 10);
+    } else if (name == "rate") {
+        options.rate = std::strtod(value, nullptr);
+    } else if (name == "seconds") {
+        options.seconds = std::strtod(value, nullptr);
+    } else if (name == "events") {
+        options.events = std::strtoull(value, nullptr, 10);
+    } else if (name == "data") {
+        options.dataBytes = std::strtoull(value, nullptr, 10);
+    } else if (name == "seed") {
+        options.seed = std::strtoull(value, nullptr, 10);
+    } else if (name == "queue") {
+        options.queue = std::strtoull(value, nullptr, 10);
+    } else if (name == "replay") {
+        options.replay = value;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void Record(LatencyHistogram& histogram, uint64_t valueNs) {
+    if (histogram.counts.empty()) {
+        histogram.counts.resize(LatencyHistogram::kBucketCount);
+    }
+    histogram.counts[LatencyHistogram::BucketIndex(valueNs)]++;
+    histogram.minNs = histogram.count == 0 ? valueNs : std::min(histogram.minNs, valueNs);
+    histogram.maxNs = std::max(histogram.maxNs, valueNs);
+    histogram.sumNs += valueNs;
+    histogram.count++;
+}
+
+// Pairs the room events delivered to a room with the time they were due,
+// in order
+struct Probe {
+    std::mutex lock;
+    std::deque<Clock::time_point> due;
+    LatencyHistogram interval;
+    LatencyHistogram total;
+
+    void Emitting(Clock::time_point when) {
+        std::lock_guard<std::mutex> guard(lock);
+        due.push_back(when);
+    }
+
+    void Delivered() {
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> guard(lock);
+        if (due.empty()) {
+            return;
+        }
+        uint64_t latencyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - due.front()).count();
+        due.pop_front();
+        Record(interval, latencyNs);
+        Record(total, latencyNs);
+    }
+
+    LatencyHistogram TakeInterval() {
+        std::lock_guard<std::mutex> guard(lock);
+        LatencyHistogram taken = std::move(interval);
+        interval = LatencyHistogram{};
+        return taken;
+    }
+};
+
+size_t ResidentBytes() {
+#if defined(__linux__)
+    if (FILE *statm = std::fopen("/proc/self/statm", "r")) {
+        unsigned long size = 0, resident = 0;
+        int read = std::fscanf(statm, "%lu %lu", &size, &resident);
+        std::fclose(statm);
+        if (read == 2) {
+            return static_cast<size_t>(resident) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        }
+    }
+#endif
+    return 0;
+}
+
+double Us(uint64_t ns) {
+    return static_cast<double>(ns) / 1000.0;
+}
+
+// Throughput of the events delivered to the rooms over `seconds`
+void PrintLine(const char *label, double at, double seconds, const LatencyHistogram& latency,
+               size_t residentBytes, const mock::MockStats& mockStats, uint64_t dropped) {
+    std::printf("%-5s %7.1fs %10.0f ev/s  p50 %8.1fus  p99 %8.1fus  p99.9 %8.1fus  max %8.1fus  "
+                "rss %7.1fMB  handles %7zu (%.1fMB)  dropped %" PRIu64 "\n",
+                label, at, seconds > 0 ? latency.count / seconds : 0.0,
+                Us(latency.PercentileNs(50)), Us(latency.PercentileNs(99)), Us(latency.PercentileNs(99.9)),
+                Us(latency.maxNs), residentBytes / 1e6, mockStats.liveHandles, mockStats.liveBytes / 1e6, dropped);
+    std::fflush(stdout);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        if (!ParseOption(argv[i], options)) {
+            std::fprintf(stderr,
+                         "usage: %s [--rooms=N] [--participants=N] [--audio=N] [--video=N] [--rate=EV/S]\n"
+                         "          [--seconds=S] [--events=N] [--data=BYTES] [--seed=N] [--queue=THREADS]\n"
+                         "          [--replay=EVENT_LOG]\n",
+                         argv[0]);
+            return 2;
+        }
+    }
+
+    FfiClient& client = FfiClient::getInstance();
+    client.EnableMetrics();
+    if (options.queue > 0) {
+        EventQueueOptions queueOptions;
+        queueOptions.dispatcherThreads = options.queue;
+        queueOptions.pinned = options.queue > 1;
+        client.EnableEventQueue(queueOptions);
+    }
+
+    mock::SimulatedRoomOptions roomOptions;
+    roomOptions.participants = options.participants;
+    roomOptions.audioTracksPerParticipant = options.audioTracks;
+    roomOptions.videoTracksPerParticipant = options.videoTracks;
+    mock::SetRoomOptions(roomOptions);
+
+    std::vector<LoggedEvent> recorded;
+    if (!options.replay.empty()) {
+        try {
+            recorded = ReadEventLog(options.replay);
+        } catch (const std::exception& e) {
+            std::fprintf(stderr, "%s\n", e.what());
+            return 1;
+        }
+    }
+
+    // Connected one at a time, so each room pairs with its RoomInfo
+    std::vector<std::unique_ptr<Room>> rooms;
+    std::vector<RoomInfo> infos;
+    Clock::time_point connectStart = Clock::now();
+    for (size_t i = 0; i < options.rooms; ++i) {
+        auto room = std::make_unique<Room>();
+        std::promise<RoomInfo> connected;
+        ConnectOptions connectOptions;
+        connectOptions.autoSubscribe = false;
+        room->Connect("wss://stress.invalid", "token", connectOptions, [&connected](const ConnectCallback& callback) {
+            connected.set_value(callback.room());
+        });
+        infos.push_back(connected.get_future().get());
+        rooms.push_back(std::move(room));
+    }
+    std::printf("connected %zu rooms of %zu participants in %.1fms\n", options.rooms, options.participants,
+                std::chrono::duration<double, std::milli>(Clock::now() - connectStart).count());
+
+    std::vector<std::unique_ptr<Probe>> probes;
+    std::vector<FfiClient::ListenerId> listeners;
+    std::vector<std::unique_ptr<mock::Replayer>> replayers;
+    for (size_t i = 0; i < options.rooms; ++i) {
+        std::vector<LoggedEvent> events = recorded.empty()
+                                              ? mock::GenerateTraffic(infos[i], options.events, std::chrono::microseconds(0),
+                                                                      {options.seed + i, options.dataBytes})
+                                              : recorded;
+        if (events.empty()) {
+            std::fprintf(stderr, "nothing to replay\n");
+            return 1;
+        }
+
+        // Only room events reach the probe
+        auto isRoomEvent = std::make_shared<std::vector<bool>>();
+        for (const LoggedEvent& event : events) {
+            FFIEvent decoded;
+            decoded.ParseFromString(event.bytes);
+            isRoomEvent->push_back(decoded.has_room_event());
+        }
+
+        probes.push_back(std::make_unique<Probe>());
+        Probe *probe = probes.back().get();
+        listeners.push_back(client.AddViewListener(EventSubscription::ForRoom(infos[i].sid()),
+                                                   [probe](const EventView&) { probe->Delivered(); }));
+
+        mock::ReplayOptions replayOptions;
+        replayOptions.loops = 0;
+        replayOptions.roomSid = infos[i].sid();
+        if (recorded.empty() || options.rate > 0) {
+            replayOptions.eventsPerSecond = options.rate;
+            replayOptions.speed = options.rate > 0 ? 1.0 : 0.0;
+        }
+        replayOptions.onEmit = [probe, isRoomEvent](size_t index, Clock::time_point due) {
+            if ((*isRoomEvent)[index]) {
+                probe->Emitting(due);
+            }
+        };
+        replayers.push_back(std::make_unique<mock::Replayer>(events, replayOptions));
+    }
+
+    const size_t startRss = ResidentBytes();
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+    Clock::time_point lastReport = start;
+    size_t peakRss = startRss;
+    while (Clock::now() < end) {
+        std::this_thread::sleep_until(std::min(end, lastReport + std::chrono::seconds(1)));
+        Clock::time_point now = Clock::now();
+
+        LatencyHistogram latency;
+        for (auto& probe : probes) {
+            latency.Merge(probe->TakeInterval());
+        }
+        size_t rss = ResidentBytes();
+        peakRss = std::max(peakRss, rss);
+        PrintLine("run", std::chrono::duration<double>(now - start).count(),
+                  std::chrono::duration<double>(now - lastReport).count(), latency, rss, mock::GetStats(),
+                  client.GetMetrics().eventsDropped);
+        lastReport = now;
+    }
+
+    for (auto& replayer : replayers) {
+        replayer->Stop();
+    }
+    replayers.clear();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LatencyHistogram total;
+    for (auto& probe : probes) {
+        std::lock_guard<std::mutex> guard(probe->lock);
+        total.Merge(probe->total);
+    }
+    for (FfiClient::ListenerId id : listeners) {
+        client.RemoveListener(id);
+    }
+
+    FfiMetrics metrics = client.GetMetrics();
+    size_t endRss = ResidentBytes();
+    PrintLine("total", elapsed, elapsed, total, endRss, mock::GetStats(), metrics.eventsDropped);
+    std::printf("%" PRIu64 " events dispatched, listeners p99 %.1fus, rss %+.1fMB over the run (peak %.1fMB)\n",
+                metrics.eventsDispatched, Us(metrics.listeners.PercentileNs(99)),
+                (static_cast<double>(endRss) - static_cast<double>(startRss)) / 1e6, peakRss / 1e6);
+    return 0;
+}